@@ -22,6 +22,59 @@
 
 #include "Arduino.h"
 #include "SevenSeg.h"
+#include "SevenSegBus.h"
+#if defined(__linux__)
+#include "SevenSegLinux.h"
+#endif
+
+// Estimated CPU cycles spent by interruptAction() including the interrupt overhead. Used for
+// planning the refresh rate. TICK is spent on every interrupt, SWITCH additionally on every
+// digit being switched on (pin writes and extracting the digit to write).
+#define SEVENSEG_TICK_CYCLES 80L
+#define SEVENSEG_SWITCH_CYCLES 800L
+
+#ifndef F_CPU
+#define F_CPU 16000000L
+#endif
+
+// Size regression check. Several displays may be used on parts with only 2 KB of RAM, so the
+// object must stay small. The state of optional features belongs in Ext.
+#if defined(__AVR__)
+static_assert(sizeof(SevenSeg)<=70, "SevenSeg has grown larger than 70 bytes");
+#endif
+
+// Disables interrupts and returns what's needed to restore them with unlockInterrupts(). Unlike a
+// cli()/sei() pair, this leaves interrupts disabled if they already were, e.g. in a caller's
+// critical section or during static initialization.
+static inline byte lockInterrupts(){
+#if defined(__AVR__)
+  byte sreg = SREG;
+  cli();
+  return sreg;
+#else
+  cli();
+  return 0;
+#endif
+}
+
+static inline void unlockInterrupts(byte sreg){
+#if defined(__AVR__)
+  SREG = sreg;
+#else
+  sei();
+#endif
+}
+
+// Writes a pin through the GPIO backend if one is assigned (Linux only), or with digitalWrite()
+inline void SevenSeg::pinWrite(int pin, int value){
+#if defined(__linux__)
+  if(_gpio){
+    _gpio->writeLines(1,&pin,&value);
+    return;
+  }
+#endif
+  digitalWrite(pin, value);
+}
 
 // Constructor
 SevenSeg::SevenSeg(int A,int B,int C,int D,int E,int F,int G){
@@ -65,10 +118,19 @@ SevenSeg::SevenSeg(int A,int B,int C,int D,int E,int F,int G){
   _digitOffDelay=0;
   _dutyCycle=100;
 
+  _pinWrites=0;
+  _framePinWrites=0;
+
+#if defined(__linux__)
+  _gpio=0;
+  _hostTimer=0;
+#endif
+
   // Timer data (default values when no timer is assigned)
   _timerDigit=0;
   _timerPhase=1;
   _timerID=-1;
+  _tickLen=1;
   _timerCounter=0;
   _timerCounterOnEnd=0;
   _timerCounterOffEnd=0;
@@ -76,7 +138,21 @@ SevenSeg::SevenSeg(int A,int B,int C,int D,int E,int F,int G){
   _writeInt=0;
   _writePoint=0;
   _writeStr=0;
+  _frame=0;
+  _rawSymb=0;
   _writeMode=' ';
+  _maskFn=0;
+
+  // Only the built-in font
+  _fontWide=0;
+
+  // Allocated when first used (see ext())
+  _ext=0;
+  _clockActive=0;
+  _bus=0;
+#if defined(__AVR__)
+  _isrNest=0;
+#endif
 
   // Clear display
   clearDisp();
@@ -99,45 +175,360 @@ void SevenSeg::setCommonCathode(){
 void SevenSeg::clearDisp(){
 
   for(int i=0;i<_numOfDigits;i++){
-    digitalWrite(_dig[i], _digOff);
+    pinWrite(_dig[i], _digOff);
   }
-  digitalWrite(_A, _segOff);
-  digitalWrite(_B, _segOff);
-  digitalWrite(_C, _segOff);
-  digitalWrite(_D, _segOff);
-  digitalWrite(_E, _segOff);
-  digitalWrite(_F, _segOff);
-  digitalWrite(_G, _segOff);
+  pinWrite(_A, _segOff);
+  pinWrite(_B, _segOff);
+  pinWrite(_C, _segOff);
+  pinWrite(_D, _segOff);
+  pinWrite(_E, _segOff);
+  pinWrite(_F, _segOff);
+  pinWrite(_G, _segOff);
 
   if(_DP!=-1){	// Clear DP too if assigned
-    digitalWrite(_DP, _segOff);
+    pinWrite(_DP, _segOff);
   }
 
   if(_symbDigPin!=-1){
-    digitalWrite(_symbDigPin, _digOff);
+    pinWrite(_symbDigPin, _digOff);
+  }
+
+  _curDigit=-1;
+  _segLit=0;
+
+}
+
+// Returns the number of pin writes used by interruptAction() during the last complete frame
+int SevenSeg::getFrameTransitions(){
+  return _framePinWrites;
+}
+
+/*
+ * OPTIONAL FEATURES
+ *
+ * The state of everything beyond showing what's written (animations, clock, power saving, scan order,
+ * frame synchronization, fading, pages, keypad, port output, queue, raw segment data, String copies,
+ * user fonts and the CPU budget) is reached through one block that ext() allocates when the first of
+ * them is used. A display using none of them has only the pointer to it, and interruptAction() skips
+ * them all with one test. The state of each feature is in turn allocated when it's first used.
+ */
+
+struct SevenSeg::Ext {
+  Animation *anim;		// Animation state (see playAnimation())
+  Clock *clock;			// Self-running clock state (see setClock())
+  Power *power;			// Power saving state (see setAutoStop() and setIdle())
+  Scan *scan;			// Order to switch on the digits in (see setScanOrder()). Sequential when 0.
+  Sync *sync;			// Frame counter and callback (see setFrameCallback())
+  Fade *fade;			// Brightness fade state (see fadeTo())
+  Pages *pages;			// Registered pages (see addPage())
+  Keys *keys;			// Keypad return pins and debouncing state (see setKeyPins())
+#if defined(__AVR__)
+  Port *port;			// Port output tables (see setPortOutput()). Pins are written one by one when 0.
+#endif
+  String *writeStrObj;		// Copy of the string to write in case of String
+  SevenSegQueue *queue;		// Queue to show frames from in case of queue
+  byte *segBuf;			// Copy of raw segment data
+  const byte *font;		// User font in program memory, 0 if not in use
+  byte cpuBudget;		// Share of the CPU (in percent) the refresh rate is planned for. 0 when not in use.
+  FrameFn frame;		// Steps the queue, pages or animation at the end of each display frame, 0 for none
+};
+
+// Returns the optional feature block, allocating it with all features unused. 0 if out of memory.
+SevenSeg::Ext *SevenSeg::ext(){
+
+  if(_ext==0){
+    Ext *ext = new Ext();	// Zero-initialized
+    if(ext==0) return 0;
+    byte sreg = lockInterrupts();
+    _ext = ext;
+    unlockInterrupts(sreg);
+  }
+
+  return _ext;
+
+}
+
+/*
+ * PORT OUTPUT
+ *
+ * After setPortOutput(1), when all segment pins (A-G, and DP if assigned) are on the same 8-bit port,
+ * writeSegs() writes them all in one store to the port, and the segments change at the same instant.
+ * Likewise, when all digit pins are on the same port, a digit is switched in one store. portSetup()
+ * checks this whenever the pins change, and builds tables mapping segment masks to port bits. If the
+ * pins are spread on several ports they are written one by one as without it. The tables take 46 bytes
+ * of RAM, which is why this is off by default. setPortOutput(0) frees them again. This is only done on
+ * AVR, elsewhere setPortOutput() does nothing.
+ */
+
+#if defined(__AVR__)
+
+struct SevenSeg::Port {
+  volatile uint8_t *segOut;	// Output register of the segment port, 0 if not all on one port
+  byte segMask;			// Port bits used by the segments
+  byte segLo[16];		// Port bits for segments A-D, indexed by bits 0-3 of a segment mask
+  byte segHi[16];		// Port bits for segments E-G and DP, indexed by bits 4-7 of a segment mask
+  volatile uint8_t *digOut;	// Output register of the digit port, 0 if not all on one port
+  byte digMask;			// Port bits used by the digits
+  byte digBit[SEVENSEG_MAX_DIGITS];	// Port bit of each digit
+};
+
+// Sets the bits in "mask" of the port register "out" to "bits" without affecting the others
+void SevenSeg::portWrite(volatile uint8_t *out, byte mask, byte bits){
+
+  byte sreg = lockInterrupts();	// Other code may write the same port from interrupts
+  *out = (*out & ~mask) | bits;
+  unlockInterrupts(sreg);
+
+}
+
+#endif
+
+void SevenSeg::setPortOutput(int on){
+
+#if defined(__AVR__)
+
+  if(on && (_ext==0 || _ext->port==0)){
+    if(ext()==0) return;
+    Port *port = new Port;
+    if(port==0) return;
+    port->segOut = 0;
+    port->digOut = 0;
+    byte sreg = lockInterrupts();
+    _ext->port = port;
+    unlockInterrupts(sreg);
+    portSetup();
+  }
+
+  if(!on && _ext && _ext->port){
+    byte sreg = lockInterrupts();
+    Port *port = _ext->port;
+    _ext->port = 0;
+    unlockInterrupts(sreg);
+    delete port;
+  }
+
+#endif
+
+}
+
+void SevenSeg::portSetup(){
+
+#if defined(__AVR__)
+
+  if(_ext==0 || _ext->port==0) return;	// Not enabled with setPortOutput()
+
+  SevenSegPin segPins[8] = {_A,_B,_C,_D,_E,_F,_G,_DP};
+  byte segBit[8];
+  byte segMask = 0;
+  byte segPort = digitalPinToPort(_A);
+  int segOk = (segPort!=NOT_A_PIN);
+
+  for(int i=0;i<8;i++){
+    segBit[i] = 0;
+    if(segPins[i]==-1) continue;	// DP not assigned
+    segBit[i] = digitalPinToBitMask(segPins[i]);
+    if(digitalPinToPort(segPins[i])!=segPort || (segMask & segBit[i])) segOk = 0;
+    segMask |= segBit[i];
+  }
+
+  byte digBit[SEVENSEG_MAX_DIGITS];
+  byte digMask = 0;
+  byte digPort = _numOfDigits ? digitalPinToPort(_dig[0]) : NOT_A_PIN;
+  int digOk = (digPort!=NOT_A_PIN);
+
+  for(int i=0;i<_numOfDigits;i++){
+    digBit[i] = digitalPinToBitMask(_dig[i]);
+    if(digitalPinToPort(_dig[i])!=digPort || (digMask & digBit[i])) digOk = 0;
+    digMask |= digBit[i];
+  }
+
+  // May be called from the constructor, before interrupts are enabled, or with a timer running
+  byte sreg = lockInterrupts();
+
+  _ext->port->segOut = 0;
+  if(segOk){
+    for(int m=0;m<16;m++){
+      byte lo = 0;
+      byte hi = 0;
+      for(int i=0;i<4;i++){
+        if(m & (1<<i)){
+          lo |= segBit[i];
+          hi |= segBit[i+4];
+        }
+      }
+      _ext->port->segLo[m] = lo;
+      _ext->port->segHi[m] = hi;
+    }
+    _ext->port->segMask = segMask;
+    _ext->port->segOut = portOutputRegister(segPort);
+  }
+
+  _ext->port->digOut = 0;
+  if(digOk){
+    for(int i=0;i<_numOfDigits;i++) _ext->port->digBit[i] = digBit[i];
+    _ext->port->digMask = digMask;
+    _ext->port->digOut = portOutputRegister(digPort);
+  }
+
+  unlockInterrupts(sreg);
+
+#endif
+
+}
+
+// Turns off the digit currently switched on (if any)
+void SevenSeg::digitOff(){
+
+  if(_curDigit==_numOfDigits){
+    pinWrite(_symbDigPin, _digOff);
+    _pinWrites++;
+  } else if(_curDigit!=-1){
+#if defined(__AVR__)
+    if(_ext && _ext->port && _ext->port->digOut) portWrite(_ext->port->digOut, _ext->port->digMask, _digOn ? 0 : _ext->port->digMask);
+    else
+#endif
+    pinWrite(_dig[_curDigit], _digOff);
+    _pinWrites++;
+  }
+
+  _curDigit=-1;
+
+}
+
+// Turns off those of the segments in "mask" which are lit (same bit order as _segLit)
+void SevenSeg::clearSegs(int mask){
+
+  writeSegs(_segLit & ~mask);
+
+}
+
+// Lights the segments in "mask" and turns off the others. Only the pins of segments that
+// differ from those lit now are written, and segments are turned off before others are
+// turned on to avoid running current through too many LEDs at once.
+void SevenSeg::writeSegs(int mask){
+
+  int diff = _segLit ^ mask;
+  int off = diff & _segLit;
+  int on = diff & mask;
+
+  if(diff==0) return;
+
+#if defined(__AVR__)
+  if(_ext && _ext->port && _ext->port->segOut){	// Write all the segments in one store to the port
+    byte bits = _ext->port->segLo[mask & 0x0F] | _ext->port->segHi[(mask >> 4) & 0x0F];
+    portWrite(_ext->port->segOut, _ext->port->segMask, _segOn ? bits : _ext->port->segMask & ~bits);
+    _pinWrites++;
+    _segLit = mask;
+    return;
+  }
+#endif
+
+#if defined(__linux__)
+  if(_gpio){	// Write all the changed segments in one request
+    int segPins[8] = {_A,_B,_C,_D,_E,_F,_G,_DP};
+    int pins[8];
+    int values[8];
+    int n = 0;
+    for(int i=0;i<8;i++){
+      if((diff & (1<<i)) && segPins[i]!=-1){
+        pins[n] = segPins[i];
+        values[n] = (mask & (1<<i)) ? _segOn : _segOff;
+        n++;
+      }
+    }
+    _gpio->writeLines(n,pins,values);
+    for(; diff; diff &= diff-1) _pinWrites++;
+    _segLit = mask;
+    return;
   }
+#endif
+
+  if(off & SEVENSEG_A) pinWrite(_A, _segOff);
+  if(off & SEVENSEG_B) pinWrite(_B, _segOff);
+  if(off & SEVENSEG_C) pinWrite(_C, _segOff);
+  if(off & SEVENSEG_D) pinWrite(_D, _segOff);
+  if(off & SEVENSEG_E) pinWrite(_E, _segOff);
+  if(off & SEVENSEG_F) pinWrite(_F, _segOff);
+  if(off & SEVENSEG_G) pinWrite(_G, _segOff);
+  if((off & SEVENSEG_DP) && _DP!=-1) pinWrite(_DP, _segOff);
+
+  if(on & SEVENSEG_A) pinWrite(_A, _segOn);
+  if(on & SEVENSEG_B) pinWrite(_B, _segOn);
+  if(on & SEVENSEG_C) pinWrite(_C, _segOn);
+  if(on & SEVENSEG_D) pinWrite(_D, _segOn);
+  if(on & SEVENSEG_E) pinWrite(_E, _segOn);
+  if(on & SEVENSEG_F) pinWrite(_F, _segOn);
+  if(on & SEVENSEG_G) pinWrite(_G, _segOn);
+  if((on & SEVENSEG_DP) && _DP!=-1) pinWrite(_DP, _segOn);
+
+  // Count the transitions (one bit set per written pin)
+  for(; diff; diff &= diff-1) _pinWrites++;
+
+  _segLit = mask;
+
+}
+
+// Turns on digit number "digit"
+void SevenSeg::digitOn(int digit){
+
+#if defined(__AVR__)
+  if(_ext && _ext->port && _ext->port->digOut){
+    byte bit = _ext->port->digBit[digit];
+    portWrite(_ext->port->digOut, _ext->port->digMask, _digOn ? bit : _ext->port->digMask & ~bit);
+    return;
+  }
+#endif
+
+  pinWrite(_dig[digit], _digOn);
+
+}
+
+// Returns the segment bit(s) driven by "pin", or 0 if it is not one of the segment pins
+int SevenSeg::pinMask(int pin){
+
+  int mask = 0;
+
+  if(pin==-1) return 0;
+
+  if(pin==_A) mask |= SEVENSEG_A;
+  if(pin==_B) mask |= SEVENSEG_B;
+  if(pin==_C) mask |= SEVENSEG_C;
+  if(pin==_D) mask |= SEVENSEG_D;
+  if(pin==_E) mask |= SEVENSEG_E;
+  if(pin==_F) mask |= SEVENSEG_F;
+  if(pin==_G) mask |= SEVENSEG_G;
+  if(pin==_DP) mask |= SEVENSEG_DP;
+
+  return mask;
 
 }
 
-/* OLD METHOD
-   This method works, but you have to make a (static) array outside the object and it
-   will only be pointed to by this object. That's not very pretty since the object doesn't
-   actually contain all the information about the display. Further on you rely on the array
-   being declared in a persistent scope and that the user doesn't change it.
+/* The digit pins are copied into the object, so the array passed need not be kept after the
+   call. Returns 0 on success, or -1 without changing anything if numOfDigits is negative or
+   larger than SEVENSEG_MAX_DIGITS (8).
 */
-void SevenSeg::setDigitPins(int numOfDigits, int *pDigitPins){
-  _dig=pDigitPins;
+int SevenSeg::setDigitPins(int numOfDigits, int *pDigitPins){
+  if(numOfDigits<0 || numOfDigits>SEVENSEG_MAX_DIGITS) return -1;
   _numOfDigits=numOfDigits;
 
   for(int i=0;i<_numOfDigits;i++){
+    _dig[i]=pDigitPins[i];
     pinMode(_dig[i],OUTPUT);
   }
 
   clearDisp();
+  portSetup();
 
-  // Set the default refresh rate of 100 Hz. If the user wants another refresh rate this
-  // would have to be set after the setDigitPins function.
-  setRefreshRate(100);
+  // The scan order depends on the number of digits
+  if(_ext && _ext->scan) scanTable();
+
+  // Set the default refresh rate of 100 Hz, or plan it within the CPU budget if one is set.
+  // If the user wants another refresh rate this would have to be set after the setDigitPins
+  // function.
+  if(_ext && _ext->cpuBudget!=0) setCpuBudget(_ext->cpuBudget);
+  else setRefreshRate(100);
+
+  return 0;
 }
 
 void SevenSeg::setDigitDelay(long int delay){
@@ -148,6 +539,7 @@ void SevenSeg::setDigitDelay(long int delay){
 void SevenSeg::setDutyCycle(int dc){
   _dutyCycle=dc;
   updDelay();
+  wake();
 }
 
 void SevenSeg::setActivePinState(int segActive, int digActive){
@@ -168,6 +560,185 @@ void SevenSeg::setRefreshRate(int freq){
   setDigitDelay(digitDelay);
 }
 
+/*
+ * SCAN ORDER
+ *
+ * interruptAction() normally switches on the digits from left to right, which at low refresh rates may
+ * be seen as a band rolling across the display. setScanOrder(order) sets another order:
+ *
+ * SEVENSEG_SCAN_SEQUENTIAL - 0, 1, 2, ... (default)
+ * SEVENSEG_SCAN_INTERLEAVED - even digits first, then odd digits, i.e. 0, 2, 4, ..., 1, 3, 5, ...
+ * SEVENSEG_SCAN_BITREVERSED - digit numbers with the bits reversed, i.e. 0, 4, 2, 6, 1, 5, 3, 7 for
+ *                             8 digits, which spreads neighbouring digits as far apart as possible
+ *
+ * setScanOrder(order, count) sets a custom order, where order[i] is the i'th digit to switch on. It must
+ * hold each digit once, or it's ignored. The order is precomputed into a table that interruptAction()
+ * indexes. The symbol digit is always switched on last. setDigitPins() recomputes the table, and a custom
+ * order is then replaced by the sequential one.
+ */
+
+struct SevenSeg::Scan {
+  byte order;			// One of SEVENSEG_SCAN_*, or 0xFF for custom
+  byte digits[SEVENSEG_MAX_DIGITS];	// Digit to switch on for each step of the scan
+};
+
+void SevenSeg::setScanOrder(int order){
+
+  scanTable(order);
+
+}
+
+void SevenSeg::setScanOrder(const byte *order, int count){
+
+  if(count!=_numOfDigits) return;
+
+  // Each digit must occur exactly once
+  for(int i=0;i<count;i++){
+    if(order[i]>=count) return;
+    for(int j=0;j<i;j++) if(order[j]==order[i]) return;
+  }
+
+  Scan table;
+  table.order=0xFF;
+  for(int i=0;i<count;i++) table.digits[i]=order[i];
+  scanSet(table);
+
+}
+
+// Recomputes the scan table for the current number of digits
+void SevenSeg::scanTable(){
+
+  scanTable(_ext->scan->order);
+
+}
+
+// Computes the scan table for "order" and the current number of digits
+void SevenSeg::scanTable(byte order){
+
+  Scan table;
+  int n = 0;
+
+  table.order=order;
+
+  if(order==SEVENSEG_SCAN_INTERLEAVED){
+
+    for(int i=0;i<_numOfDigits;i+=2) table.digits[n++]=i;
+    for(int i=1;i<_numOfDigits;i+=2) table.digits[n++]=i;
+
+  } else if(order==SEVENSEG_SCAN_BITREVERSED){
+
+    // Reverse the bits of each number below the nearest power of two, skipping those not being digits
+    int bits = 0;
+    while((1<<bits)<_numOfDigits) bits++;
+
+    for(int i=0;i<(1<<bits);i++){
+      int r = 0;
+      for(int b=0;b<bits;b++) if(i & (1<<b)) r |= 1<<(bits-1-b);
+      if(r<_numOfDigits) table.digits[n++]=r;
+    }
+
+  } else {	// Sequential, also replacing a custom order
+
+    table.order=SEVENSEG_SCAN_SEQUENTIAL;
+    for(int i=0;i<_numOfDigits;i++) table.digits[n++]=i;
+
+  }
+
+  scanSet(table);
+
+}
+
+// Makes interruptAction() use the complete table "table". It must never see a partly filled table.
+void SevenSeg::scanSet(const Scan &table){
+
+  if(ext()==0) return;
+
+  if(_ext->scan==0){
+    Scan *scan = new Scan;
+    if(scan==0) return;
+    *scan = table;
+    byte sreg = lockInterrupts();
+    _ext->scan=scan;
+    unlockInterrupts(sreg);
+  } else {
+    byte sreg = lockInterrupts();
+    *_ext->scan = table;
+    unlockInterrupts(sreg);
+  }
+
+}
+
+/*
+ * CAPACITY PLANNING
+ *
+ * The timer interrupts every 16us (1024us when sharing timer0) regardless of the refresh rate, and on top
+ * of that each digit switch costs some pin writes and computations. getIsrLoad() estimates the share of
+ * the CPU (in percent) spent in interruptAction() for the current refresh rate and number of digits.
+ * getDutyStep() returns the smallest step in duty cycle (in percent) that can be resolved with the
+ * interrupt period. If the time per digit is shorter than one period it returns 100, i.e. duty cycle
+ * control is not possible.
+ *
+ * setCpuBudget(int percent) sets the highest refresh rate for which the estimated load is within the
+ * budget and returns it (0 if even the interrupts alone exceed the budget). The budget is remembered
+ * such that setDigitPins() plans the refresh rate again. Zero turns planning off.
+ *
+ * On AVR, interruptAction() only keeps interrupts disabled while counting the tick and testing whether
+ * a digit is to be switched. The switching itself, including the handover between the displays of a
+ * SevenSegBus, is done with interrupts enabled, such that e.g. the serial port isn't kept waiting (see
+ * multiplex()). The bench in extras/avr measures the most cycles they're kept disabled in one tick.
+ */
+
+int SevenSeg::getIsrLoad(){
+
+  if(_timerID==-1 || _digitDelay==0) return 0;
+
+  long int switches = 1000000L/_digitDelay;	// Digits switched on per second
+  long int cycles = (62500L/_tickLen)*SEVENSEG_TICK_CYCLES + switches*SEVENSEG_SWITCH_CYCLES;
+
+  return (int)(cycles/(long int)(F_CPU/100L));
+
+}
+
+int SevenSeg::getDutyStep(){
+
+  long int tick = 16L*_tickLen;
+  long int ticks = (_digitDelay+tick/2)/tick;	// Interrupts per digit, rounded like the phases
+
+  if(ticks<2) return 100;
+  return (int)((100+ticks-1)/ticks);
+
+}
+
+int SevenSeg::setCpuBudget(int percent){
+
+  if(percent==0){
+    if(_ext) _ext->cpuBudget=0;
+    return 0;
+  }
+
+  if(ext()==0) return 0;
+  _ext->cpuBudget=percent;
+
+  int digits = _numOfDigits;
+  if(_symbDigPin!=-1) digits++;	// Separate symbol pin in use. One more digit to multiplex across.
+  if(digits==0) return 0;
+
+  long int cycles = percent*(long int)(F_CPU/100L) - (62500L/_tickLen)*SEVENSEG_TICK_CYCLES;
+  if(cycles<=0) return 0;
+
+  long int switches = cycles/SEVENSEG_SWITCH_CYCLES;	// Digits that may be switched on per second
+  if(switches<1) return 0;
+
+  // Round up to keep within budget, and give each digit at least one interrupt on and one off.
+  long int digitDelay = (1000000L+switches-1)/switches;
+  if(digitDelay<32L*_tickLen) digitDelay=32L*_tickLen;
+
+  setDigitDelay(digitDelay);
+
+  return (int)(1000000L/(digitDelay*digits));
+
+}
+
 /*
  * HIGH LEVEL WRITE-FUNCTIONS
  *
@@ -188,13 +759,17 @@ void SevenSeg::setRefreshRate(int freq){
  * int _writeInt	- Stores the number for write(int), writeFixed() and writeClock() (convert to only one number bb for clock)
  * float _writeFloat	- Stores the float for write(float)
  * char* _writeStr	- Stores a pointer to a string to be written. This pointer must be maintained outside the class
- * String _writeStrObj	- Stores a string object to be written.
+ * String *writeStrObj	- Stores a copy of a string object to be written (in the optional feature block)
  * char _writeMode	- Describes which writing function/mode is used:
  *				i - write(int)
  *				f - write(float)
  *				p - write()
  *				s - write(char* a)
  *				o - write(String)
+ *				q - setQueue()
+ *				a - playAnimation()
+ *				r - writeSegments() or writeSegmentsRef()
+ *				g - showPage()
  *				: - writeClock() with colon as decimator
  *				. - writeClock() with period as decimator
  *				_ - writeClock() with no decimator
@@ -244,14 +819,21 @@ void SevenSeg::writeClock(int ss, char c){
 
 void SevenSeg::writeClock(int mm, int ss){
 
+  writeClock(mm,ss,clockSeparator());
+
+}
+
+// Separator used by writeClock(aa,bb) here and in windows and pages
+char SevenSeg::clockSeparator(){
+
   // Use ':' if assigned, '.' otherwise, or simply nothing if none assigned
 
   if(_colonSegPin!=-1){
-    writeClock(mm,ss,':');
+    return ':';
   } else if(_DP!=-1){
-    writeClock(mm,ss,'.');
+    return '.';
   } else {
-    writeClock(mm,ss,'_');
+    return '_';
   }
 
 }
@@ -289,68 +871,592 @@ void SevenSeg::writeClock(int mm, int ss, char c){
 
   } else {
 
-    _writeMode=c;
     _writeInt=mm*100+ss;
+    _clockActive=0;
+    setMode(c,maskClock);
+    wake();
 
   }
 
 }
 
-void SevenSeg::write(int num,int point){
-  write((long int)num, point);
+/*
+ * SELF-RUNNING CLOCK
+ *
+ * Instead of calling writeClock() every second the display can keep the time itself. setClock(aa,bb) shows
+ * aa:bb (using the same decimator rules as writeClock()) and stores it as the value restored by resetClock().
+ * startClock() and stopClock() starts and stops the clock, which is stepped by interruptAction(). Hence this
+ * only works when a timer is assigned. setClockStep() sets how many seconds each step of bb lasts, i.e.
+ * 1 for mm:ss (default) or 60 for hh:mm, and setClockDir() sets whether to count up (1) or down (-1).
+ * Counting up wraps around at 99:59 (mm:ss) or 23:59 (hh:mm). Counting down stops at 00:00 and sets the
+ * flag returned by clockZero().
+ *
+ * The four clock digits are stored as characters and are only changed when the clock steps, where the
+ * carry or borrow is propagated from the rightmost digit. The interrupt routine then writes them directly
+ * without any divisions.
+ */
+
+void SevenSeg::setClock(int aa, int bb){
+
+  setClock(aa,bb,clockSeparator());
+
 }
 
-void SevenSeg::write(long int num,int point){
+// Self-running clock state. The clock digits aabb are kept as characters and stepped with carry/borrow
+// by interruptAction() when the clock ticks, so nothing needs to be computed to display them.
+struct SevenSeg::Clock {
+  char digits[4];		// Digits currently shown, most significant first
+  char preset[4];		// Digits restored by resetClock()
+  volatile byte run;		// 1 when the clock is running
+  volatile byte zero;		// Set when counting down reaches zero
+  signed char dir;		// 1 to count up, -1 to count down
+  byte step;			// Seconds per step of bb, i.e. 1 for mm:ss and 60 for hh:mm
+  long int counter;		// Counts interrupts since the last step
+  long int counterEnd;		// How far counter should count to make one step
+  void (*tick)(Clock *);	// clockTick(). Called through this such that it's only linked when the clock is used.
+};
+
+// Returns the clock state, allocating it (default mm:ss counting up from 00:00) on first use
+SevenSeg::Clock *SevenSeg::clockState(){
+
+  if(ext()==0) return 0;
+
+  if(_ext->clock==0){
+    Clock *c = new Clock;
+    if(c==0) return 0;
+    for(int i=0;i<4;i++){
+      c->digits[i]='0';
+      c->preset[i]='0';
+    }
+    c->run=0;
+    c->zero=0;
+    c->dir=1;
+    c->step=1;
+    c->counter=0;
+    c->counterEnd=62500L;	// One second of 16us interrupts
+    c->tick=clockTick;
+    _ext->clock=c;
+  }
 
-  if(_timerID==-1){  // No timer assigned. MUX once.
+  return _ext->clock;
 
-    // Compute the maximum positive and negative numbers possible to display
-    // (TBD: Move this to a computation done on pin assignments?)
-    long int maxNegNum=1;
-    for(int i=1;i<=_numOfDigits-1;i++) maxNegNum*=10;
-    long int maxPosNum=10*maxNegNum-1;
-    maxNegNum=-maxNegNum+1;
+}
 
-    // TBD: Change to displaying OL (overload) or ---- or similar?
-    if(num>maxPosNum) num=maxPosNum;
-    if(num<maxNegNum) num=maxNegNum;
+void SevenSeg::setClock(int aa, int bb, char c){
 
-    if(point==0){    // Don't display decimal point if zero decimals used
-      point=_numOfDigits;          // value if-sentence won't trigger on
-    } else {
-      point=_numOfDigits-point-1;  // Map number of decimal points to digit number
-    }
+  Clock *clk = clockState();
+  if(clk==0) return;
 
-    // TBD: Fix minus
+  clk->preset[0]=(char)('0'+(aa/10)%10);
+  clk->preset[1]=(char)('0'+aa%10);
+  clk->preset[2]=(char)('0'+(bb/10)%6);
+  clk->preset[3]=(char)('0'+bb%10);
 
-    int minus=0;
-    if(num<0){
-      num*=-1;
-      minus=1;
-    }
+  resetClock();
 
-/* USED IN v1.0 - DOESN'T SUPPRESS LEADING ZEROS
-    for(int i=_numOfDigits-1;i>=0;i--){
-      changeDigit(i);
-      int nextDigit = num % 10L;
-      if(minus&&i==0) writeDigit('-');
-      else writeDigit(nextDigit);       // TBD: Possible future update: don't write insignificant zeroes
-      if(point==i) setDP();
-      num /= 10;
-      execDelay(_digitOnDelay);
-      writeDigit(' ');
-      clearDP();
-      execDelay(_digitOffDelay);
-    }
-*/
+  _clockActive=1;
+  setMode(c,maskClock);
+  wake();
 
-    for(int i=_numOfDigits-1;i>=0;i--){
-        changeDigit(i);
-        int nextDigit = num % 10L;
-        if(num || i>point-1 || i==_numOfDigits-1){
-            writeDigit(nextDigit);
-        } else if(minus){
-            writeDigit('-');
+}
+
+void SevenSeg::setClockStep(int seconds){
+  Clock *clk = clockState();
+  if(clk==0) return;
+  clk->step=seconds;
+  clk->counterEnd=62500L*seconds;	// 62500 interrupts of 16us per second
+}
+
+void SevenSeg::setClockDir(int dir){
+  Clock *clk = clockState();
+  if(clk==0) return;
+  clk->dir=dir;
+}
+
+void SevenSeg::startClock(){
+
+  Clock *clk = clockState();
+  if(clk==0) return;
+
+  // Nothing to count down from
+  if(clk->dir<0 && clk->digits[0]=='0' && clk->digits[1]=='0' && clk->digits[2]=='0' && clk->digits[3]=='0'){
+    clk->zero=1;
+    return;
+  }
+
+  clk->run=1;
+  wake();
+
+}
+
+void SevenSeg::stopClock(){
+  if(_ext && _ext->clock) _ext->clock->run=0;
+}
+
+void SevenSeg::resetClock(){
+
+  Clock *clk = clockState();
+  if(clk==0) return;
+
+  byte sreg = lockInterrupts();
+  for(int i=0;i<4;i++) clk->digits[i]=clk->preset[i];
+  clk->counter=0;
+  clk->zero=0;
+  unlockInterrupts(sreg);
+
+}
+
+int SevenSeg::clockZero(){
+  if(_ext==0 || _ext->clock==0) return 0;
+  return _ext->clock->zero;
+}
+
+// Steps the clock one unit of bb up or down. Called by interruptAction().
+void SevenSeg::clockTick(Clock *clk){
+
+  char *d = clk->digits;
+  int hhmm = (clk->step>=60);	// Hours wrap at 24 rather than 100
+
+  if(clk->dir>0){
+
+    if(++d[3]>'9'){
+      d[3]='0';
+      if(++d[2]>'5'){
+        d[2]='0';
+        if(++d[1]>'9' || (hhmm && d[0]=='2' && d[1]>'3')){
+          d[1]='0';
+          if(++d[0]>(hhmm ? '2' : '9')) d[0]='0';
+        }
+      }
+    }
+
+  } else {
+
+    if(--d[3]<'0'){
+      d[3]='9';
+      if(--d[2]<'0'){
+        d[2]='5';
+        if(--d[1]<'0'){
+          d[1]='9';
+          --d[0];
+        }
+      }
+    }
+
+    if(d[0]=='0' && d[1]=='0' && d[2]=='0' && d[3]=='0'){
+      clk->run=0;
+      clk->zero=1;
+    }
+
+  }
+
+}
+
+/*
+ * FADING
+ *
+ * fadeTo(dc, ms) changes the duty cycle gradually to "dc" percent over "ms" milliseconds. The number of
+ * frames and the on- and off-times at the start and end of the fade are computed at once, and
+ * interruptAction() steps the on- and off-times at each frame boundary Bresenham style, i.e. by adding
+ * and comparing without any division. The brightness then changes in as small steps as the interrupt
+ * period allows. fadeDone() returns 1 when the fade has finished. setDutyCycle() or changing the refresh
+ * rate stops the fade. Without a timer the duty cycle is set at once.
+ */
+
+struct SevenSeg::Fade {
+  volatile byte done;		// 1 when finished or stopped
+  byte target;			// Duty cycle at the end of the fade
+  signed char dir;		// 1 for increasing on-time, -1 for decreasing
+  unsigned int frames;		// Frames of the fade
+  unsigned int left;		// Frames left
+  unsigned int steps;		// Interrupt periods the on-time changes during the fade
+  unsigned long int err;	// Accumulated steps not yet taken, times frames. Holds up to frames+steps.
+  unsigned int onEnd;		// _timerCounterOnEnd at the end of the fade
+  unsigned int offEnd;		// _timerCounterOffEnd at the end of the fade
+  long int onDelay;		// _digitOnDelay at the end of the fade
+  void (*step)(SevenSeg *);	// fadeStep(). Called through this such that it's only linked when fading is used.
+};
+
+void SevenSeg::fadeTo(int dc, unsigned int ms){
+
+  int digits = _numOfDigits;
+  if(_symbDigPin!=-1) digits++;	// Separate symbol pin in use. One more digit to multiplex across.
+
+  long int period = _digitDelay*digits;	// Frame period in microseconds
+  unsigned long int frames = period ? (unsigned long int)ms*1000/period : 0;
+
+  if(_timerID==-1 || frames==0){
+    setDutyCycle(dc);
+    return;
+  }
+  if(frames>65535) frames=65535;
+
+  if(ext()==0) return;
+
+  if(_ext->fade==0){
+    _ext->fade = new Fade;
+    if(_ext->fade==0) return;
+    _ext->fade->done=1;
+    _ext->fade->step=fadeStep;
+  }
+
+  // On- and off-times at the end of the fade, like updDelay()
+  long int onDelay = _digitDelay*dc/100;
+  unsigned int onEnd, offEnd;
+  phaseEnds(dc, onEnd, offEnd);
+
+  byte sreg = lockInterrupts();
+  _ext->fade->done=1;		// Not stepped while being set up
+  _ext->fade->target=dc;
+  _ext->fade->onEnd=onEnd;
+  _ext->fade->offEnd=offEnd;
+  _ext->fade->onDelay=onDelay;
+  _ext->fade->dir = (onEnd>=_timerCounterOnEnd) ? 1 : -1;
+  _ext->fade->steps = (onEnd>=_timerCounterOnEnd) ? onEnd-_timerCounterOnEnd : _timerCounterOnEnd-onEnd;
+  _ext->fade->frames=frames;
+  _ext->fade->left=frames;
+  _ext->fade->err=0;
+  _ext->fade->done=0;
+  unlockInterrupts(sreg);
+
+  wake();
+
+}
+
+int SevenSeg::fadeDone(){
+  if(_ext==0 || _ext->fade==0) return 1;
+  return _ext->fade->done;
+}
+
+// Steps the fade one frame. Called by interruptAction() at the frame boundary.
+void SevenSeg::fadeStep(SevenSeg *d){
+
+  Fade *f = d->_ext->fade;
+
+  if(--f->left==0){	// Finished. Set the exact end values.
+    d->_timerCounterOnEnd=f->onEnd;
+    d->_timerCounterOffEnd=f->offEnd;
+    d->_dutyCycle=f->target;
+    d->_digitOnDelay=f->onDelay;
+    d->_digitOffDelay=d->_digitDelay-f->onDelay;
+    f->done=1;
+    return;
+  }
+
+  // Move the on-time steps/frames periods per frame, and the off-time the opposite way
+  f->err += f->steps;
+  while(f->err>=f->frames){
+    f->err -= f->frames;
+    d->_timerCounterOnEnd += f->dir;
+    if(f->dir>0){
+      if(d->_timerCounterOffEnd) d->_timerCounterOffEnd--;
+    } else {
+      d->_timerCounterOffEnd++;
+    }
+  }
+
+}
+
+/*
+ * POWER SAVING
+ *
+ * Normally the timer interrupts every 16us as long as it runs, also when nothing is shown. setAutoStop(1)
+ * makes interruptAction() stop the timer at the end of a display frame when all segments and symbols were
+ * off during that frame, or the duty cycle is 0. setIdle(timeout, slowdown) makes it lengthen the interrupt
+ * period "slowdown" times (1-64) when nothing has been written for "timeout" milliseconds. The refresh rate
+ * drops by the same factor. Both only happen when the content is static, i.e. not when showing a queue, an
+ * animation or a running clock. The next write function (or setDutyCycle()) wakes the display immediately.
+ * Segment masks changed directly in the frame from getFrame() or the array given to writeSegmentsRef()
+ * does not wake it, so call getFrame() again after changing them.
+ *
+ * getActiveTime() and getIdleTime() returns the time (in milliseconds) spent active and idle (slowed down
+ * or stopped) since power saving was first enabled. It's measured using millis(), which doesn't work when
+ * timer0 is used for the display.
+ */
+
+struct SevenSeg::Power {
+  enum { ACTIVE, IDLE, STOPPED };
+  byte autoStop;		// Whether to stop the timer when the display is blank
+  byte slowdown;		// Interrupt period when idle in units of 16us
+  volatile byte state;		// ACTIVE, IDLE or STOPPED
+  volatile byte woken;		// Set when written to during the display frame being shown
+  byte lit;			// Segments lit during the display frame being shown
+  unsigned long int idleTicks;	// Interrupts without writing before going idle. 0 when not in use.
+  volatile unsigned long int counter;	// Interrupts since last written to
+  unsigned long int since;	// millis() when the state last changed
+  unsigned long int activeTime;
+  unsigned long int idleTime;
+  int (*check)(SevenSeg *);	// powerCheck() and powerWake(). Called through these such that they (and
+  void (*wake)(SevenSeg *);	// millis()) are only linked when power saving is used.
+};
+
+SevenSeg::Power *SevenSeg::powerState(){
+
+  if(ext()==0) return 0;
+
+  if(_ext->power==0){
+    _ext->power = new Power;
+    if(_ext->power==0) return 0;
+    _ext->power->autoStop=0;
+    _ext->power->slowdown=1;
+    _ext->power->state=Power::ACTIVE;
+    _ext->power->woken=1;
+    _ext->power->lit=0;
+    _ext->power->idleTicks=0;
+    _ext->power->counter=0;
+    _ext->power->since=millis();
+    _ext->power->activeTime=0;
+    _ext->power->idleTime=0;
+    _ext->power->check=powerCheck;
+    _ext->power->wake=powerWake;
+  }
+
+  return _ext->power;
+
+}
+
+void SevenSeg::setAutoStop(int on){
+  Power *pwr = powerState();
+  if(pwr==0) return;
+  pwr->autoStop=on;
+}
+
+void SevenSeg::setIdle(unsigned int timeout, int slowdown){
+
+  Power *pwr = powerState();
+  if(pwr==0) return;
+
+  if(slowdown<1) slowdown=1;
+  if(slowdown>64) slowdown=64;	// Largest period the 8-bit timers can make
+
+  byte sreg = lockInterrupts();
+  pwr->slowdown=slowdown;
+  pwr->idleTicks=(unsigned long int)timeout*125/2;	// 62.5 interrupts of 16us per millisecond
+  pwr->counter=0;
+  unlockInterrupts(sreg);
+
+}
+
+unsigned long int SevenSeg::getActiveTime(){
+
+  if(_ext==0 || _ext->power==0) return 0;
+
+  byte sreg = lockInterrupts();
+  unsigned long int t = _ext->power->activeTime;
+  if(_ext->power->state==Power::ACTIVE) t += millis()-_ext->power->since;
+  unlockInterrupts(sreg);
+
+  return t;
+
+}
+
+unsigned long int SevenSeg::getIdleTime(){
+
+  if(_ext==0 || _ext->power==0) return 0;
+
+  byte sreg = lockInterrupts();
+  unsigned long int t = _ext->power->idleTime;
+  if(_ext->power->state!=Power::ACTIVE) t += millis()-_ext->power->since;
+  unlockInterrupts(sreg);
+
+  return t;
+
+}
+
+// Changes the power state and adds the time spent in the previous state
+void SevenSeg::powerSwitch(byte state){
+
+  unsigned long int now = millis();
+
+  if(_ext->power->state==Power::ACTIVE) _ext->power->activeTime += now-_ext->power->since;
+  else _ext->power->idleTime += now-_ext->power->since;
+
+  _ext->power->since=now;
+  _ext->power->state=state;
+
+}
+
+// Called by interruptAction() at the end of each display frame. Returns 1 if the timer was stopped.
+int SevenSeg::powerCheck(SevenSeg *d){
+
+  Power *pwr = d->_ext->power;
+  byte lit = pwr->lit;
+  byte woken = pwr->woken;
+  pwr->lit=0;
+  pwr->woken=0;
+
+  // Not static if written to during the frame, or changed by interruptAction() itself
+  if(woken) return 0;
+  if(d->_ext->frame || (d->_ext->clock && d->_ext->clock->run) || (d->_ext->fade && !d->_ext->fade->done)){
+    pwr->counter=0;
+    return 0;
+  }
+
+  if(d->_writeMode==':' || d->_colonState==d->_segOn || d->_aposState==d->_segOn) lit=1;
+
+  if(pwr->autoStop && (lit==0 || d->_dutyCycle==0)){
+    d->digitOff();
+    d->clearSegs(0xFF);
+    d->powerSwitch(Power::STOPPED);
+    d->setTick(0);
+    return 1;
+  }
+
+  if(pwr->state==Power::ACTIVE && pwr->idleTicks!=0 && pwr->counter>=pwr->idleTicks){
+    d->powerSwitch(Power::IDLE);
+    d->setTick(pwr->slowdown);
+  }
+
+  return 0;
+
+}
+
+// Restores the interrupt period if idle or stopped. Called by the write functions.
+void SevenSeg::wake(){
+
+  if(_ext && _ext->power) _ext->power->wake(this);
+
+}
+
+void SevenSeg::powerWake(SevenSeg *d){
+
+  Power *pwr = d->_ext->power;
+
+  byte sreg = lockInterrupts();
+  pwr->counter=0;
+  pwr->woken=1;
+  if(pwr->state!=Power::ACTIVE){
+    d->powerSwitch(Power::ACTIVE);
+    d->setTick(1);
+  }
+  unlockInterrupts(sreg);
+
+}
+
+/*
+ * FRAME SYNCHRONIZATION
+ *
+ * A frame is finished when interruptAction() has shown the last digit (or the symbol digit). At that point
+ * it increments the counter returned by frameCount() and calls the function set by setFrameCallback(), if
+ * any, before showing the first digit of the next frame. The callback runs in the interrupt, so it must be
+ * short. It may change the content or the duty cycle, which then takes effect from the start of the frame.
+ * waitForFrame() waits until the next frame is finished, such that the main loop can update the display
+ * once per frame. It returns at once if no timer is running. Frames are counted from the first use of any
+ * of these functions.
+ */
+
+struct SevenSeg::Sync {
+  void (*callback)();		// Called when a frame is finished, 0 for none
+  volatile unsigned long int frames;	// Frames finished
+};
+
+SevenSeg::Sync *SevenSeg::syncState(){
+
+  if(ext()==0) return 0;
+
+  if(_ext->sync==0){
+    Sync *sync = new Sync;
+    if(sync==0) return 0;
+    sync->callback=0;
+    sync->frames=0;
+    _ext->sync=sync;
+  }
+
+  return _ext->sync;
+
+}
+
+void SevenSeg::setFrameCallback(void (*callback)()){
+
+  Sync *sync = syncState();
+  if(sync==0) return;
+
+  byte sreg = lockInterrupts();
+  sync->callback=callback;
+  unlockInterrupts(sreg);
+
+}
+
+unsigned long int SevenSeg::frameCount(){
+
+  Sync *sync = syncState();
+  if(sync==0) return 0;
+
+  byte sreg = lockInterrupts();
+  unsigned long int frames = sync->frames;
+  unlockInterrupts(sreg);
+
+  return frames;
+
+}
+
+void SevenSeg::waitForFrame(){
+
+  unsigned long int frames = frameCount();
+
+  while(frameCount()==frames){
+    if(_timerID==-1) return;	// No frames coming
+    if(_ext && _ext->power && _ext->power->state==Power::STOPPED) return;
+  }
+
+}
+
+
+void SevenSeg::write(int num,int point){
+  write((long int)num, point);
+}
+
+void SevenSeg::write(long int num,int point){
+
+  if(_timerID==-1){  // No timer assigned. MUX once.
+
+    // Compute the maximum positive and negative numbers possible to display
+    // (TBD: Move this to a computation done on pin assignments?)
+    long int maxNegNum=1;
+    for(int i=1;i<=_numOfDigits-1;i++) maxNegNum*=10;
+    long int maxPosNum=10*maxNegNum-1;
+    maxNegNum=-maxNegNum+1;
+
+    // TBD: Change to displaying OL (overload) or ---- or similar?
+    if(num>maxPosNum) num=maxPosNum;
+    if(num<maxNegNum) num=maxNegNum;
+
+    if(point==0){    // Don't display decimal point if zero decimals used
+      point=_numOfDigits;          // value if-sentence won't trigger on
+    } else {
+      point=_numOfDigits-point-1;  // Map number of decimal points to digit number
+    }
+
+    // TBD: Fix minus
+
+    int minus=0;
+    if(num<0){
+      num*=-1;
+      minus=1;
+    }
+
+/* USED IN v1.0 - DOESN'T SUPPRESS LEADING ZEROS
+    for(int i=_numOfDigits-1;i>=0;i--){
+      changeDigit(i);
+      int nextDigit = num % 10L;
+      if(minus&&i==0) writeDigit('-');
+      else writeDigit(nextDigit);       // TBD: Possible future update: don't write insignificant zeroes
+      if(point==i) setDP();
+      num /= 10;
+      execDelay(_digitOnDelay);
+      writeDigit(' ');
+      clearDP();
+      execDelay(_digitOffDelay);
+    }
+*/
+
+    for(int i=_numOfDigits-1;i>=0;i--){
+        changeDigit(i);
+        int nextDigit = num % 10L;
+        if(num || i>point-1 || i==_numOfDigits-1){
+            writeDigit(nextDigit);
+        } else if(minus){
+            writeDigit('-');
             minus=0;
         } else {
             writeDigit(' ');
@@ -371,9 +1477,10 @@ void SevenSeg::write(long int num,int point){
       point=_numOfDigits-point-1;  // Map number of decimal points to digit number
     }
 
-	_writeMode = 'p';	// Tell interruptAction that write(int,int) was used (fixed point).
 	_writeInt = iaLimitInt(num);	// Tell interruptAction to write this number ...
         _writePoint = point;	// ... with this fixed point
+	setMode('p',maskFixed);	// Tell interruptAction that write(int,int) was used (fixed point).
+	wake();
   }
 
 }
@@ -440,8 +1547,9 @@ void SevenSeg::write(long int num){
 
   } else {  // Use timer
 
-	_writeMode = 'i';	// Tell interruptAction that write(int) is used.
 	_writeInt = iaLimitInt(num);	// Tell interruptAction to write this int
+	setMode('i',maskInt);	// Tell interruptAction that write(int) is used.
+	wake();
   }
 
 }
@@ -469,8 +1577,9 @@ void SevenSeg::write(char *str){
     }
 
   } else {  // Use timer
-	_writeMode = 's';	// Tell interruptAction that write(char*) is used.
 	_writeStr = str;	// Tell interruptAction to write this string
+	setMode('s',maskStr);	// Tell interruptAction that write(char*) is used.
+	wake();
   }
 
 
@@ -480,7 +1589,7 @@ void SevenSeg::write(String str){
 
   if(_timerID==-1){  // No timer assigned. MUX once.
 
-    int i=0;
+    unsigned int i=0;
     int j=0;
     clearColon();
     while(i<str.length()){
@@ -498,72 +1607,775 @@ void SevenSeg::write(String str){
       j++;
     }
 
-  } else {  // Use timer
+  } else {  // Use timer
+
+	// Allocate the copy of the string only when write(String) is used
+	if(ext()==0) return;
+	if(_ext->writeStrObj==0) _ext->writeStrObj = new String(str);
+	else *_ext->writeStrObj = str;	// Tell interruptAction to write this string
+	if(_ext->writeStrObj) setMode('o',maskString);	// Tell interruptAction that write(String) is used.
+	wake();
+  }
+
+
+}
+
+void SevenSeg::write(double num, int point){
+    write(roundFixed(num,point),point);
+}
+
+// Rounds num to a fixed point number with "point" decimals, as used by write(double,int) here and in
+// windows and pages
+long int SevenSeg::roundFixed(double num, int point){
+    for(int i=0;i<point;i++) num*=10;
+    long int intNum = (long int) num;
+    double remainder = num - intNum;
+    if(remainder>=0.5 && num>0) intNum++;
+    if(remainder<=0.5 && num<0) intNum--;
+    return intNum;
+}
+
+void SevenSeg::write(double num){
+
+    long int intNum;
+    int point = 0;
+
+    if(num>-1 && num<1){
+
+        for(point = 0; point<_numOfDigits-1; point++) num *= 10;
+
+        intNum = (long int)(num + 0.5 - (num<0));
+
+        if(intNum < 0){
+            num /= 10;
+            point--;
+            intNum = (long int)(num + 0.5 - (num<0));
+        }
+
+    } else {
+
+        int digitsBeforeDecimal = 1;
+        for(long int i = (long int) num; i != 0; i /= 10) digitsBeforeDecimal++;
+
+        point = _numOfDigits - digitsBeforeDecimal - (num<0) + 1;
+        for(int d=0; d<point; d++) num *= 10;
+
+        intNum = (long int)(num + 0.5 - (num<0));
+
+    }
+
+    if(_timerID==-1){
+
+        write(intNum,point);
+
+    } else { // user timer
+
+        // Adapting to another format
+        point=point+1-_numOfDigits;
+
+        _writePoint=-point;
+        _writeInt=(long int)num;
+        setMode('p',maskFixed);
+        wake();
+
+    }
+
+}
+
+/*
+ * RAW SEGMENT DATA
+ *
+ * writeSegments(masks, count) shows segment masks computed by the caller, one per digit (see
+ * SEVENSEG_A-SEVENSEG_DP), without any formatting. If count is larger than the number of digits the
+ * next mask holds the symbols (SEVENSEG_COLON and SEVENSEG_APOS), which are shown as with
+ * setColon()/setApos().
+ *
+ * When using a timer the masks are copied, whereas writeSegmentsRef(masks, count) lets interruptAction()
+ * read them directly from the caller's array. The array must then be kept, and changing it changes the
+ * display. Without a timer both multiplex once, like the other write functions.
+ */
+
+void SevenSeg::writeSegments(const byte *masks, int count){
+
+  if(_timerID==-1){  // No timer assigned. MUX once.
+
+    writeSegmentsRef(masks, count);
+
+  } else {
+
+    // Allocate the copy only when writeSegments() is used
+    if(getFrame()==0) return;
+
+    byte sreg = lockInterrupts();
+    for(int i=0;i<=SEVENSEG_MAX_DIGITS;i++) _ext->segBuf[i] = (i<count) ? masks[i] : 0;
+    _frame=_ext->segBuf;
+    _rawSymb=(count>_numOfDigits);
+    setMode('r',maskFrame);
+    unlockInterrupts(sreg);
+    wake();
+
+  }
+
+}
+
+void SevenSeg::writeSegmentsRef(const byte *masks, int count){
+
+  if(_timerID==-1){  // No timer assigned. MUX once.
+
+    for(int i=0;i<_numOfDigits;i++){
+      changeDigit(i);
+      writeSegs(i<count ? masks[i] : 0);
+      execDelay(_digitOnDelay);
+      writeSegs(0);
+      execDelay(_digitOffDelay);
+    }
+
+    if(count>_numOfDigits){
+      writeSymbols(masks[_numOfDigits]);
+      if(_symbDigPin!=-1){
+        changeDigit('s');
+        execDelay(_digitOnDelay);
+        changeDigit(' ');
+        execDelay(_digitOffDelay);
+      }
+    }
+
+  } else {
+
+    byte sreg = lockInterrupts();
+    _frame=masks;
+    _rawSymb=(count>_numOfDigits);
+    setMode('r',maskFrame);
+    unlockInterrupts(sreg);
+    wake();
+
+  }
+
+}
+
+// Returns the frame buffer shown by interruptAction(), for writing segment masks into it directly.
+// Allocated on first use.
+byte *SevenSeg::getFrame(){
+
+  if(ext()==0) return 0;
+
+  if(_ext->segBuf==0){
+    _ext->segBuf = new byte[SEVENSEG_MAX_DIGITS+1];
+    if(_ext->segBuf==0) return 0;
+    for(int i=0;i<=SEVENSEG_MAX_DIGITS;i++) _ext->segBuf[i]=0;
+  }
+
+  if(_writeMode!='r' || _frame!=_ext->segBuf){
+    byte sreg = lockInterrupts();
+    _frame=_ext->segBuf;
+    _rawSymb=0;
+    setMode('r',maskFrame);
+    unlockInterrupts(sreg);
+  }
+
+  wake();
+
+  return _ext->segBuf;
+
+}
+
+// Sets colon and apostrophe according to the symbol mask "symb"
+void SevenSeg::writeSymbols(byte symb){
+
+  if(_colonSegPin!=-1){
+    if(symb & SEVENSEG_COLON) setColon();
+    else clearColon();
+  }
+
+  if(_aposSegPin!=-1){
+    if(symb & SEVENSEG_APOS) setApos();
+    else clearApos();
+  }
+
+}
+
+/*
+ * RENDERING
+ *
+ * These functions render the same formats as the write functions into "width" segment masks at
+ * "dst", e.g. for SevenSegWindow. renderInt(dst, width, num, point) writes num with "point" decimals
+ * like write(long int,int), renderStr(dst, width, str) writes a string like write(char*) and
+ * renderClock(dst, width, aa, bb, c) writes aa and bb like writeClock(int,int,char). Colon is
+ * not part of the masks, so ':' is rendered like '_'.
+ */
+
+void SevenSeg::renderInt(byte *dst, int width, long int num, int point){
+
+  // Limit to the maximum positive and negative numbers possible to display
+  long int maxNegNum=1;
+  for(int i=1;i<=width-1;i++) maxNegNum*=10;
+  long int maxPosNum=10*maxNegNum-1;
+  maxNegNum=-maxNegNum+1;
+
+  if(num>maxPosNum) num=maxPosNum;
+  if(num<maxNegNum) num=maxNegNum;
+
+  if(point==0){    // Don't display decimal point if zero decimals used
+    point=width;          // value if-sentence won't trigger on
+  } else {
+    point=width-point-1;  // Map number of decimal points to digit number
+  }
+
+  int minus=0;
+  if(num<0){
+    num*=-1;
+    minus=1;
+  }
+
+  for(int i=width-1;i>=0;i--){
+    byte mask;
+    if(num || i>point-1 || i==width-1){
+      mask = digitMask(num % 10L);
+    } else if(minus){
+      mask = charMask('-');
+      minus=0;
+    } else {
+      mask = 0;
+    }
+    if(point==i) mask |= SEVENSEG_DP;
+    dst[i] = mask;
+    num /= 10;
+  }
+
+}
+
+void SevenSeg::renderStr(byte *dst, int width, const char *str){
+
+  int i=0;
+  for(int j=0;j<width;j++){
+    byte mask = 0;
+    if(str[i]!='\0'){
+      mask = charMask(str[i]);
+      if(str[i+1]=='.'){
+        mask |= SEVENSEG_DP;
+        i++;
+      }
+      i++;
+    }
+    dst[j] = mask;
+  }
+
+}
+
+void SevenSeg::renderClock(byte *dst, int width, int aa, int bb, char c){
+
+  int num = aa*100+bb;
+
+  for(int i=width-1;i>=0;i--){
+    byte mask = digitMask(num % 10);
+    if((c=='.')&&(i==width-3)) mask |= SEVENSEG_DP;  // Only set "." in the right place
+    dst[i] = mask;
+    num /= 10;
+  }
+
+}
+
+/*
+ * HEXADECIMAL, BINARY AND RAW BYTES
+ *
+ * writeHex(value, width, zeros) and writeBin(value, width, zeros) writes the lowest "width" hexadecimal or
+ * binary digits of value right aligned on the display. Leading zeros are suppressed unless "zeros" is 1.
+ * writeHex(value) and writeBin(value) uses all digits of the display. writeBytes(bytes, count) writes
+ * each byte as two hexadecimal digits starting from the left.
+ *
+ * Each digit is extracted by shifting and masking and its glyph is looked up in the font, so no divisions
+ * or strings are needed. With a timer the masks are rendered once into the frame shown by interruptAction().
+ */
+
+// Characters for each hexadecimal digit
+static const char hexChars[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+
+void SevenSeg::writeHex(unsigned long int value){
+  writeRadix(value,4,_numOfDigits,0);
+}
+
+void SevenSeg::writeHex(unsigned long int value, int width, int zeros){
+  writeRadix(value,4,width,zeros);
+}
+
+void SevenSeg::writeBin(unsigned long int value){
+  writeRadix(value,1,_numOfDigits,0);
+}
+
+void SevenSeg::writeBin(unsigned long int value, int width, int zeros){
+  writeRadix(value,1,width,zeros);
+}
+
+// Writes "value" with "bits" bits per digit
+void SevenSeg::writeRadix(unsigned long int value, int bits, int width, int zeros){
+
+  byte local[SEVENSEG_MAX_DIGITS];
+  byte *dst = (_timerID==-1) ? local : getFrame();
+  if(dst==0) return;
+
+  if(width<=0 || width>_numOfDigits) width=_numOfDigits;
+
+  int blank = _numOfDigits-width;
+  for(int i=0;i<blank;i++) dst[i]=0;
+  renderRadix(dst+blank,width,value,bits,zeros);
+
+  if(_timerID==-1) writeSegmentsRef(local,_numOfDigits);	// No timer assigned. MUX once.
+
+}
+
+void SevenSeg::writeBytes(const byte *bytes, int count){
+
+  byte local[SEVENSEG_MAX_DIGITS];
+  byte *dst = (_timerID==-1) ? local : getFrame();
+  if(dst==0) return;
+
+  for(int i=0;i<_numOfDigits;i++){
+    int b = i/2;
+    if(b<count) dst[i] = charMask(hexChars[(i & 1) ? (bytes[b] & 0x0F) : (bytes[b] >> 4)]);
+    else dst[i] = 0;
+  }
+
+  if(_timerID==-1) writeSegmentsRef(local,_numOfDigits);	// No timer assigned. MUX once.
+
+}
+
+// Renders "width" digits of "value" with "bits" bits per digit (4 for hexadecimal, 1 for binary)
+void SevenSeg::renderRadix(byte *dst, int width, unsigned long int value, int bits, int zeros){
+
+  byte digitBits = (1<<bits)-1;
+
+  for(int i=width-1;i>=0;i--){
+    if(value==0 && !zeros && i!=width-1){	// Leading zero suppression
+      dst[i] = 0;
+    } else {
+      dst[i] = charMask(hexChars[value & digitBits]);
+    }
+    value >>= bits;
+  }
+
+}
+
+/*
+ * ANIMATIONS
+ *
+ * playAnimation(frames, count, rate, loop) shows an animation stored in program memory, e.g.:
+ *
+ *   const byte spinner[] PROGMEM = {SEVENSEG_A, 0, 0, 0,   0, SEVENSEG_A, 0, 0,   0, 0, SEVENSEG_A, 0, ...};
+ *   disp.playAnimation(spinner, 6, 10, 1);
+ *
+ * "frames" holds count frames, each with one segment mask per digit. The frames are shown at "rate"
+ * frames per second, starting over after the last frame if "loop" is 1, or otherwise stopping at the
+ * last frame and setting the flag returned by animationDone(). interruptAction() reads the masks
+ * directly from program memory so the animation takes no RAM. Any of the write functions stops the
+ * animation. The call is ignored unless "count" and "rate" are at least 1. Since the animation frame
+ * only changes between display frames, rates above the refresh rate show one animation frame per
+ * display frame.
+ */
+
+// Animation state
+struct SevenSeg::Animation {
+  const byte *frames;		// Animation frames in program memory
+  int count;			// Number of frames in the animation
+  int index;			// Index of the frame being shown
+  byte loop;			// 1 to start over after the last frame
+  volatile byte done;		// Set when a one-shot animation has shown its last frame
+  long int counter;		// Counts interrupts since the frame was shown
+  long int counterEnd;		// Interrupts per animation frame
+};
+
+void SevenSeg::playAnimation(const byte *frames, int count, int rate, int loop){
+
+  if(count<1 || rate<1) return;
+  if(ext()==0) return;
+
+  if(_ext->anim==0){
+    _ext->anim = new Animation;
+    if(_ext->anim==0) return;
+  }
+
+  byte sreg = lockInterrupts();
+  _ext->anim->frames=frames;
+  _ext->anim->count=count;
+  _ext->anim->index=0;
+  _ext->anim->loop=loop;
+  _ext->anim->counter=0;
+  _ext->anim->counterEnd=62500L/rate;	// 62500 interrupts of 16us per second
+  if(_ext->anim->counterEnd<1) _ext->anim->counterEnd=1;
+  _ext->anim->done=0;
+  _frame=frames;
+  setMode('a',maskProgmem,animStep);
+  unlockInterrupts(sreg);
+  wake();
+
+}
+
+// Moves on to the next animation frame when its time has come. Called by interruptAction() at the end
+// of each display frame, such that no display frame shows parts of two animation frames.
+void SevenSeg::animStep(SevenSeg *d){
+
+  Animation *a = d->_ext->anim;
+  if(a->counter<a->counterEnd || a->done) return;
+
+  a->counter-=a->counterEnd;
+  if(a->counter>=a->counterEnd) a->counter=0;	// Faster than the refresh rate
+  if(a->index<a->count-1){
+    a->index++;
+    d->_frame+=d->_numOfDigits;
+  } else if(a->loop){
+    a->index=0;
+    d->_frame=a->frames;
+  } else {
+    a->done=1;
+  }
+
+}
+
+int SevenSeg::animationDone(){
+  if(_ext==0 || _ext->anim==0) return 0;
+  return _ext->anim->done;
+}
+
+/*
+ * PAGES
+ *
+ * A page is a frame of segment masks, one per digit followed by the symbol mask, that is kept rendered
+ * such that the display can flip between pages without any formatting. addPage(masks) registers the
+ * array "masks" as a page and returns its number (or -1 if SEVENSEG_MAX_PAGES pages are already
+ * registered). SevenSegPage does this, and renders into its own array with write functions like those
+ * of SevenSeg. showPage(page) shows a page at once by changing which frame interruptAction() reads, and
+ * setPageTime(ms) makes interruptAction() flip to the next page every "ms" milliseconds (0 to only flip
+ * with showPage()). getPage() returns the page being shown. Any of the write functions stops showing
+ * the pages. Without a timer showPage() multiplexes the page once.
+ */
+
+struct SevenSeg::Pages {
+  const byte *frames[SEVENSEG_MAX_PAGES];
+  byte count;
+  volatile byte index;		// Page being shown
+  long int counter;		// Counts interrupts since the page was shown
+  long int counterEnd;		// Interrupts per page, 0 when only flipped by showPage()
+};
+
+int SevenSeg::addPage(const byte *masks){
+
+  if(ext()==0) return -1;
+
+  if(_ext->pages==0){
+    Pages *pages = new Pages;
+    if(pages==0) return -1;
+    pages->count=0;
+    pages->index=0;
+    pages->counter=0;
+    pages->counterEnd=0;
+    _ext->pages=pages;
+  }
+
+  if(_ext->pages->count>=SEVENSEG_MAX_PAGES) return -1;
+
+  _ext->pages->frames[_ext->pages->count]=masks;
+  return _ext->pages->count++;
+
+}
+
+void SevenSeg::showPage(int page){
+
+  if(_ext==0 || _ext->pages==0 || page<0 || page>=_ext->pages->count) return;
+
+  if(_timerID==-1){  // No timer assigned. MUX once.
+
+    writeSegmentsRef(_ext->pages->frames[page], _numOfDigits+1);
+
+  } else {
+
+    byte sreg = lockInterrupts();
+    _ext->pages->index=page;
+    _ext->pages->counter=0;
+    _frame=_ext->pages->frames[page];
+    setMode('g',maskFrame,pageStep);
+    unlockInterrupts(sreg);
+    wake();
+
+  }
+
+}
+
+void SevenSeg::setPageTime(unsigned int ms){
+
+  if(_ext==0 || _ext->pages==0) return;
+
+  byte sreg = lockInterrupts();
+  _ext->pages->counterEnd=(long int)ms*125/2;	// 62.5 interrupts of 16us per millisecond
+  _ext->pages->counter=0;
+  unlockInterrupts(sreg);
+
+}
+
+// Flips to the next page when its time has come. Called by interruptAction() at the end of each display
+// frame, such that no display frame shows parts of two pages.
+void SevenSeg::pageStep(SevenSeg *d){
+
+  Pages *p = d->_ext->pages;
+  if(p->counterEnd && p->counter>=p->counterEnd){
+    p->counter-=p->counterEnd;
+    if(++p->index>=p->count) p->index=0;
+    d->_frame=p->frames[p->index];
+  }
+  d->writeSymbols(d->_frame[d->_numOfDigits]);
+
+}
+
+int SevenSeg::getPage(){
+  if(_ext==0 || _ext->pages==0) return -1;
+  return _ext->pages->index;
+}
+
+/*
+ * KEYPAD
+ *
+ * Buttons may be wired between the digit lines and a few return pins, such that the buttons are scanned
+ * along with the digits. setKeyPins(count, pins) assigns up to SEVENSEG_MAX_KEY_PINS return pins. In the
+ * off-phase after each digit, interruptAction() turns off the segments, switches the digit line on alone,
+ * reads the return pins and switches it off again. A button between digit "d" and return pin "r" is key
+ * number d*count+r. The return pins must be pulled to the off-state of the digit lines, either by the
+ * internal pull-ups (used when the digits are on when LOW) or by external resistors. Diodes in series with
+ * the buttons are needed if several buttons may be pressed at once.
+ *
+ * Each key is debounced by a two-bit counter, and only changes state after having been read the same way
+ * four frames in a row. getKeys() returns the debounced keys with key number "k" as bit "k". getKeyEvent()
+ * returns the next key pressed (as its number) or released (its number plus SEVENSEG_KEY_RELEASE), or -1
+ * if there are no more events. The last SEVENSEG_KEY_EVENTS events are kept, and events occurring while
+ * that many are unread are lost. Neither function disables interrupts.
+ */
+
+struct SevenSeg::Keys {
+  SevenSegPin pins[SEVENSEG_MAX_KEY_PINS];
+  byte count;
+  unsigned long int cnt0;		// Low and high bits of the debounce counter of each key
+  unsigned long int cnt1;
+  volatile unsigned long int state;	// Debounced keys
+  byte events[SEVENSEG_KEY_EVENTS];
+  volatile byte head;		// Written by interruptAction() only
+  volatile byte tail;		// Written by getKeyEvent() only
+  void (*scan)(SevenSeg *,byte);	// keyScan(). Called through the pointer so it is only linked when used.
+};
+
+void SevenSeg::setKeyPins(int count, int *pins){
+
+  if(count<0) count=0;
+  if(count>SEVENSEG_MAX_KEY_PINS) count=SEVENSEG_MAX_KEY_PINS;
+  if(ext()==0) return;
+
+  if(_ext->keys==0){
+    Keys *keys = new Keys;
+    if(keys==0) return;
+    keys->count=0;
+    keys->scan=keyScan;
+    _ext->keys=keys;
+  }
+
+  byte sreg = lockInterrupts();
+  for(int i=0;i<count;i++){
+    _ext->keys->pins[i]=pins[i];
+    pinMode(pins[i], _digOn==LOW ? INPUT_PULLUP : INPUT);
+  }
+  _ext->keys->count=count;
+  _ext->keys->cnt0=~0UL;
+  _ext->keys->cnt1=~0UL;
+  _ext->keys->state=0;
+  _ext->keys->head=0;
+  _ext->keys->tail=0;
+  unlockInterrupts(sreg);
+
+}
+
+unsigned long int SevenSeg::getKeys(){
+
+  if(_ext==0 || _ext->keys==0) return 0;
+
+  // Read until two reads agree, since the four bytes aren't read at once on AVR
+  unsigned long int keys;
+  do {
+    keys = _ext->keys->state;
+  } while(keys!=_ext->keys->state);
+
+  return keys;
+
+}
+
+int SevenSeg::getKeyEvent(){
 
-	_writeMode = 'o';	// Tell interruptAction that write(String) is used.
-	_writeStrObj = str;	// Tell interruptAction to write this string
-  }
+  if(_ext==0 || _ext->keys==0) return -1;
 
+  byte tail = _ext->keys->tail;
+  if(tail==_ext->keys->head) return -1;
 
-}
+  int event = _ext->keys->events[tail];
+  _ext->keys->tail = (tail+1) & (SEVENSEG_KEY_EVENTS-1);
+
+  return event;
 
-void SevenSeg::write(double num, int point){
-    for(int i=0;i<point;i++) num*=10;
-    long int intNum = (long int) num;
-    double remainder = num - intNum;
-    if(remainder>=0.5 && num>0) intNum++;
-    if(remainder<=0.5 && num<0) intNum--;
-    write(intNum,point);
 }
 
-void SevenSeg::write(double num){
+// Reads the keys on "digit" and debounces them. Called by interruptAction() in the off-phase after the digit.
+void SevenSeg::keyScan(SevenSeg *d, byte digit){
+
+  Keys *k = d->_ext->keys;
+  byte shift = digit*k->count;
+  if(k->count==0 || shift+k->count>32) return;
+
+  // Switch on the digit line with all segments off, such that nothing lights while reading
+  d->clearSegs(0xFF);
+  d->digitOn(digit);
+  d->_curDigit=digit;
+  d->_pinWrites++;
+
+  unsigned long int read = 0;
+  for(byte r=0;r<k->count;r++){
+    if(digitalRead(k->pins[r])==d->_digOn) read |= 1UL<<r;
+  }
+
+  d->digitOff();
+
+  // Count down the keys read differently from their state, and restart the others. The keys whose
+  // counters wrap around change state.
+  unsigned long int mask = ((1UL<<k->count)-1) << shift;
+  unsigned long int diff = (k->state ^ (read<<shift)) & mask;
+  unsigned long int cnt0 = ~(k->cnt0 & diff);
+  unsigned long int cnt1 = cnt0 ^ (k->cnt1 & diff);
+  diff &= cnt0 & cnt1;
+  k->cnt0 = (k->cnt0 & ~mask) | (cnt0 & mask);
+  k->cnt1 = (k->cnt1 & ~mask) | (cnt1 & mask);
+  if(diff==0) return;
+
+  unsigned long int state = k->state ^ diff;
+  k->state = state;
+
+  for(byte i=shift;diff;i++){
+    if(diff & (1UL<<i)){
+      diff &= ~(1UL<<i);
+      byte head = k->head;
+      byte next = (head+1) & (SEVENSEG_KEY_EVENTS-1);
+      if(next==k->tail) continue;	// Full
+      k->events[head] = (state & (1UL<<i)) ? i : i+SEVENSEG_KEY_RELEASE;
+      k->head = next;
+    }
+  }
 
-    long int intNum;
-    int point = 0;
+}
 
-    if(num>-1 && num<1){
+/*
+ * FRAME QUEUE
+ *
+ * setQueue() makes interruptAction() show frames from a SevenSegQueue. Frames are pushed with the
+ * segment masks for each digit and how many display frames to hold them. interruptAction() picks the
+ * next frame at the start of a display frame when the hold of the current one has run out, and keeps
+ * showing the last frame if no new frame is queued. Any of the write functions stops showing the
+ * queue.
+ *
+ * The queue has a single producer writing _head and a single consumer writing _tail. A frame is
+ * completely written before _head is moved past it, and the frame at _tail is not overwritten while
+ * it's being shown, hence no interrupts need to be disabled. Reading and writing the byte sized
+ * indices is atomic.
+ */
 
-        for(point = 0; point<_numOfDigits-1; point++) num *= 10;
+// Makes sure the frame data is written before the index publishing it
+#if defined(__linux__)
+#define SEVENSEG_BARRIER() __sync_synchronize()
+#else
+#define SEVENSEG_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
 
-        intNum = (long int)(num + 0.5 - (num<0));
+void SevenSeg::setQueue(SevenSegQueue *queue){
+  if(ext()==0) return;
+  byte sreg = lockInterrupts();
+  _ext->queue=queue;
+  _frame=0;
+  setMode('q',maskFrame,queueStep);
+  unlockInterrupts(sreg);
+  wake();
+}
 
-        if(intNum < 0){
-            num /= 10;
-            point--;
-            intNum = (long int)(num + 0.5 - (num<0));
-        }
+// Takes the next frame from the queue. Called by interruptAction() at the start of each display frame.
+void SevenSeg::queueStep(SevenSeg *d){
+  d->_frame=d->_ext->queue->nextFrame();
+}
 
-    } else {
+SevenSegQueue::SevenSegQueue(){
+  _head=0;
+  _tail=0;
+  _started=0;
+  _waiting=0;
+  _hold=0;
+  _overflows=0;
+  _underflows=0;
+}
 
-        int digitsBeforeDecimal = 1;
-        for(long int i = (long int) num; i != 0; i /= 10) digitsBeforeDecimal++;
+int SevenSegQueue::push(const byte *masks, int count, unsigned int hold){
 
-        point = _numOfDigits - digitsBeforeDecimal - (num<0) + 1;
-        for(int d=0; d<point; d++) num *= 10;
+  byte head=_head;
+  byte next=(head+1)&(SEVENSEG_QUEUE_LENGTH-1);
 
-        intNum = (long int)(num + 0.5 - (num<0));
+  if(next==_tail){
+    _overflows++;
+    return 0;
+  }
 
-    }
+  for(int i=0;i<SEVENSEG_MAX_DIGITS;i++){
+    _frames[head].masks[i] = (i<count) ? masks[i] : 0;
+  }
+  _frames[head].hold = hold;
 
-    if(_timerID==-1){
+  SEVENSEG_BARRIER();
+  _head=next;
 
-        write(intNum,point);
+  return 1;
 
-    } else { // user timer
+}
 
-        // Adapting to another format
-        point=point+1-_numOfDigits;
+int SevenSegQueue::available(){
+  return (_tail-_head-1)&(SEVENSEG_QUEUE_LENGTH-1);
+}
 
-        _writeMode='p';
-        _writePoint=-point;
-        _writeInt=(long int)num;
+unsigned int SevenSegQueue::overflows(){
+  return _overflows;
+}
+
+unsigned int SevenSegQueue::underflows(){
+  return _underflows;
+}
 
+const byte *SevenSegQueue::nextFrame(){
+
+  byte tail=_tail;
+
+  if(!_started){	// Nothing shown yet
+    if(tail==_head) return 0;
+    _started=1;
+    _hold=_frames[tail].hold;
+  } else if(_hold>1){
+    _hold--;
+  } else {		// The frame has been shown to its end. Move on to the next frame if any.
+    byte next=(tail+1)&(SEVENSEG_QUEUE_LENGTH-1);
+    if(next!=_head){
+      SEVENSEG_BARRIER();
+      _tail=tail=next;
+      _hold=_frames[tail].hold;
+      _waiting=0;
+    } else if(!_waiting){
+      _underflows++;
+      _waiting=1;
     }
+  }
+
+  return _frames[tail].masks;
 
 }
 
 void SevenSeg::updDelay(){
 
+  // Setting the duty cycle or refresh rate stops any fade
+  if(_ext && _ext->fade) _ext->fade->done=1;
+
   // On-time for each display is total time spent per digit times the duty cycle. The
   // off-time is the rest of the cycle for the given display.
 
@@ -575,30 +2387,155 @@ void SevenSeg::updDelay(){
 
   if(_timerID!=-1){
     // Artefacts in duty cycle control appeared when these values changed while interrupts happening (A kind of stepping in brightness appeared)
-    cli();
-    _timerCounterOnEnd=(_digitOnDelay/16)-1;
-    _timerCounterOffEnd=(_digitOffDelay/16)-1;
-    if(_digitOnDelay==0) _timerCounterOnEnd=0;
-    if(_digitOffDelay==0) _timerCounterOffEnd=0;
+    unsigned int onEnd, offEnd;
+    phaseEnds(_dutyCycle, onEnd, offEnd);
+    byte sreg = lockInterrupts();
+    _timerCounterOnEnd=onEnd;
+    _timerCounterOffEnd=offEnd;
 //    _timerCounter=0;
-    sei();
+    unlockInterrupts(sreg);
+  }
+}
+
+/*
+ * PHASE TIMING
+ *
+ * With a timer, each digit is on for a whole number of interrupts and then off for a whole number of
+ * interrupts. The time per digit is rounded to the nearest number of interrupts (16us each, or 1024us when
+ * sharing timer0) and the on-time to the nearest number of those. For duty cycles between 0 and 100% both
+ * phases last at least one interrupt, so a digit takes at least two interrupts and the duty cycle is
+ * resolved in steps of one interrupt (see getDutyStep()). Refresh rates and duty cycles needing shorter
+ * phases are clamped to the nearest ones possible, e.g. 4 digits at 100Hz when sharing timer0 get two
+ * interrupts per digit, i.e. 122Hz at 50% duty cycle. A phase lasts at most 65535 interrupts.
+ */
+
+// Computes how far _timerCounter should count in the on- and off-phase for the duty cycle "dc". The
+// on-phase lasts at least one interrupt, the off-phase may last none.
+void SevenSeg::phaseEnds(int dc, unsigned int &onEnd, unsigned int &offEnd){
+
+  long int tick = 16L*_tickLen;
+  long int ticks = (_digitDelay+tick/2)/tick;	// Interrupts per digit
+  long int onTicks = (ticks*dc+50)/100;
+
+  if(dc>0 && dc<100){
+    if(ticks<2) ticks=2;
+    if(onTicks<1) onTicks=1;
+    if(onTicks>ticks-1) onTicks=ticks-1;
   }
+
+  long int offTicks = ticks-onTicks;
+  onEnd = (onTicks>65535L) ? 65535 : onTicks;
+  offEnd = (offTicks>65535L) ? 65535 : offTicks;
+
 }
 
 void SevenSeg::interruptAction(){
 
+  // Displays sharing segment lines are multiplexed in turn by their bus
+  if(_bus) _bus->interruptAction();
+  else multiplex();
+
+}
+
+// Counts "ticks" interrupts on the library's counter and the timers of the features in use
+void SevenSeg::countTicks(byte ticks){
+
   // Increment the library's counter
-  _timerCounter++;
+  _timerCounter+=ticks;
+
+  keepTime(ticks);
+
+}
+
+// Counts "ticks" interrupts on the timers of the features in use. Displays on a bus do this on every
+// interrupt, also while another display is being multiplexed.
+void SevenSeg::keepTime(byte ticks){
+
+  if(_ext==0) return;	// No optional features in use
+
+  unsigned int len = ticks*_tickLen;
+
+  // Time the animation
+  if(_writeMode=='a') _ext->anim->counter+=len;
+
+  // Time the pages
+  if(_writeMode=='g') _ext->pages->counter+=len;
+
+  // Time since last written to
+  if(_ext->power) _ext->power->counter+=len;
+
+  // Step the self-running clock
+  if(_ext->clock && _ext->clock->run){
+    _ext->clock->counter+=len;
+    if(_ext->clock->counter>=_ext->clock->counterEnd){
+      _ext->clock->counter-=_ext->clock->counterEnd;
+      _ext->clock->tick(_ext->clock);
+    }
+  }
+
+}
+
+// Does the work of one timer interrupt for a display not on a bus. SevenSegBus::interruptAction() does
+// the same for the displays on a bus.
+void SevenSeg::multiplex(){
+
+#if defined(__AVR__)
+  // Interrupted by the timer while switching digits below. Only note the tick, and leave it to be
+  // counted when the switch is done.
+  if(_isrNest){
+    if(_isrNest<255) _isrNest++;
+    return;
+  }
+#endif
+
+  countTicks(1);
+
+  // Nothing more to do until the phase has ended, which is the case for most interrupts
+  if(!phaseEnded()) return;
+
+#if defined(__AVR__)
+  // Switching digits takes long compared to the interrupts of e.g. the UART (87us per byte at 115200
+  // baud). Let them in while switching, as well as the timer interrupt itself, which then only
+  // notes the tick (see above). The digit is off while the segments change, so other interrupts
+  // delaying the pin writes only shift the digit in time.
+  byte sreg = SREG;
+  _isrNest=1;
+  sei();
+#endif
+
+  switchPhase();
+
+#if defined(__AVR__)
+  cli();
+  if(_isrNest>1) countTicks(_isrNest-1);
+  _isrNest=0;
+  SREG = sreg;
+#endif
+
+}
+
+// Whether the on- or off-phase of the digit has ended
+int SevenSeg::phaseEnded(){
+  return _timerPhase==1 ? _timerCounter>=_timerCounterOnEnd : _timerCounter>=_timerCounterOffEnd;
+}
+
+// Ends the on- or off-phase of a digit. Returns 1 if the display is on a bus and has finished a frame,
+// in which case no digit has been switched on.
+int SevenSeg::switchPhase(){
 
   // Finished with on-part. Turn off digit, and switch to the off-phase (_timerPhase=0)
   if((_timerCounter>=_timerCounterOnEnd)&&(_timerPhase==1)){
     _timerCounter=0;
     _timerPhase=0;
 
-    writeDigit(' ');
+    // Only the digit is turned off. Its segments are left as they are such that only those
+    // differing on the next digit need to be written.
+    signed char digit = _curDigit;
+    digitOff();
+
+    // Read the keys on the digit line just turned off
+    if(_ext && _ext->keys && digit>=0 && digit<_numOfDigits) _ext->keys->scan(this, digit);
 
-    // If a write mode using . is used it is reasonable to assume that DP exists. Clear it (eventhough it might not be on this digit).
-    if(_writeMode=='p'||_writeMode=='.'||_writeMode=='s') clearDP();
     if(_writeMode==':') clearColon();
 
   }
@@ -614,87 +2551,179 @@ void SevenSeg::interruptAction(){
       if(_symbDigPin!=-1 && _timerDigit==_numOfDigits){  // Symbol pin in use. Let _timerDigit=_numOfDigits be used for symbol mux.
       } else { // Finished muxing symbol digit, or symbol pin not in use
         _timerDigit=0;
+        _framePinWrites=_pinWrites;
+        _pinWrites=0;
+
+        if(_ext){
+
+          // Frame finished
+          if(_ext->sync){
+            _ext->sync->frames++;
+            if(_ext->sync->callback) _ext->sync->callback();
+          }
+
+          // Step the brightness fade
+          if(_ext->fade && !_ext->fade->done) _ext->fade->step(this);
+
+          // Stop or slow down the timer if the content is static. Not on a bus, where the timer is shared.
+          if(_ext->power && !_bus && _ext->power->check(this)) return 0;
+
+          // Next frame of the queue, pages or animation
+          if(_ext->frame) _ext->frame(this);
+
+        }
+
+        // Symbols of raw segment data
+        if(_writeMode=='r' && _rawSymb) writeSymbols(_frame[_numOfDigits]);
+
+        // Hand the segment lines over to the next display on the bus
+        if(_bus) return 1;
       }
     }
 
+    scanDigit();
+
+  }
+
+  return 0;
+
+}
+
+// Switches on digit number _timerDigit of the scan with its segments. All digits must be off.
+void SevenSeg::scanDigit(){
+
     if(_timerDigit==_numOfDigits) changeDigit('s');
-    else changeDigit(_timerDigit);
 
     if(_timerDigit!=_numOfDigits){
 
-        if(_writeMode=='p'){	// Fixed point writing (or float)
-          writeDigit(iaExtractDigit(_writeInt,_timerDigit,_writePoint));
-          if(_writePoint==_timerDigit && _writePoint!=_numOfDigits-1) setDP();
-        }
+        // Digit to switch on in this step of the scan
+        byte digit = (_ext && _ext->scan) ? _ext->scan->digits[_timerDigit] : _timerDigit;
 
-        if(_writeMode=='i'){	// Integer writing
-          writeDigit(iaExtractDigit(_writeInt,_timerDigit,_numOfDigits));
-        }
+        // Segments to light on this digit
+        int mask = _maskFn ? _maskFn(this,digit) : 0;
 
-        if(_writeMode==':'||_writeMode=='.'||_writeMode=='_'){
+        // All digits are off at this point, so the segments can be changed without
+        // shadow artifacts before the digit is turned on.
+        writeSegs(mask);
+        if(_ext && _ext->power) _ext->power->lit |= mask;
+        digitOn(digit);
+        _curDigit=digit;
+        _pinWrites++;
+    }
 
-          // colon through symbpin? 1 if yes.
-          int symbColon = (_symbDigPin!=-1);
+}
 
-          if(_timerDigit==_numOfDigits){	// Symbol digit
-            setColon();
-          } else {
-            writeDigit(iaExtractDigit(_writeInt,_timerDigit,_numOfDigits));
-            if(_writeMode==':' && !symbColon) setColon();
-            if((_writeMode=='.')&&(_timerDigit==_numOfDigits-3)) setDP();  // Only set "." in the right place
-          }
+/*
+ * WRITE MODES
+ *
+ * Each write function sets _writeMode and a pointer to the function computing the segment mask of a digit
+ * in that mode, which interruptAction() calls. The queue, animation and pages also set a function stepping
+ * them at the end of each display frame. Only the functions of the write functions a sketch actually uses
+ * are referenced, so the others (e.g. the String, clock and queue handling) are left out by the linker.
+ * The self-running clock, fading, power saving and keypad are called through pointers in their state for
+ * the same reason.
+ */
 
-        }
+// Sets the write mode. All are changed at once since the pointers can't be written atomically. May
+// be called with interrupts disabled.
+void SevenSeg::setMode(char mode, MaskFn fn, FrameFn frame){
+  byte sreg = lockInterrupts();
+  _writeMode=mode;
+  _maskFn=fn;
+  if(_ext) _ext->frame=frame;	// Only the queue, animation and pages have one, and they use _ext
+  unlockInterrupts(sreg);
+}
 
-        if(_writeMode=='s'){
-
-          // This algorithm must count to the correct letter i in _writeStr for digit j, since the two may be unmatched
-          // and it is impossible to know which letter to write without counting
-          int i=0; // which digit
-          int j=0; // which digit have it counted to
-          while(_writeStr[i]!='\0' && j<_timerDigit){
-            if(_writeStr[i+1]=='.'){
-              i++;
-            }
-            i++;
-            j++;
-          }
-          writeDigit(_writeStr[i]);
-          if(_writeStr[i+1]=='.') setDP();
+int SevenSeg::maskFixed(SevenSeg *d, byte digit){	// Fixed point writing (or float)
+  int mask = d->charMask(d->iaExtractDigit(d->_writeInt,digit,d->_writePoint));
+  if(d->_writePoint==digit && d->_writePoint!=d->_numOfDigits-1) mask |= SEVENSEG_DP;
+  return mask;
+}
 
-        }
+int SevenSeg::maskInt(SevenSeg *d, byte digit){	// Integer writing
+  return d->charMask(d->iaExtractDigit(d->_writeInt,digit,d->_numOfDigits));
+}
 
-        if(_writeMode=='o'){
-
-          // This algorithm must count to the correct letter i in _writeStr for digit j, since the two may be unmatched
-          // and it is impossible to know which letter to write without counting
-          int i=0; // which digit
-          int j=0; // which digit have it counted to
-          while(i<_writeStrObj.length() && j<_timerDigit){
-            if(_writeStrObj[i+1]=='.'){
-              i++;
-            }
-            i++;
-            j++;
-          }
-          writeDigit(_writeStrObj[i]);
-          if(_writeStrObj[i+1]=='.') setDP();
+int SevenSeg::maskClock(SevenSeg *d, byte digit){	// Clock writing with ':', '.' or '_' as divisor
 
-        }
+  int mask;
+
+  if(d->_clockActive){
+    int c = digit-d->_numOfDigits+4;	// The clock digits are right aligned
+    mask = d->charMask(c>=0 ? d->_ext->clock->digits[c] : ' ');
+  } else {
+    mask = d->charMask(d->iaExtractDigit(d->_writeInt,digit,d->_numOfDigits));
+  }
+
+  // colon through symbpin? Then it's shown on the symbol digit.
+  if(d->_writeMode==':' && d->_symbDigPin==-1) d->setColon();
+  if((d->_writeMode=='.')&&(digit==d->_numOfDigits-3)) mask |= SEVENSEG_DP;  // Only set "." in the right place
+
+  return mask;
+
+}
+
+int SevenSeg::maskStr(SevenSeg *d, byte digit){
+
+  // This algorithm must count to the correct letter i in _writeStr for digit j, since the two may be unmatched
+  // and it is impossible to know which letter to write without counting
+  const char *str = d->_writeStr;
+  int i=0; // which digit
+  int j=0; // which digit have it counted to
+  while(str[i]!='\0' && j<digit){
+    if(str[i+1]=='.'){
+      i++;
     }
+    i++;
+    j++;
+  }
+
+  int mask = d->charMask(str[i]);
+  if(str[i+1]=='.') mask |= SEVENSEG_DP;
+  return mask;
+
+}
+
+int SevenSeg::maskString(SevenSeg *d, byte digit){
 
+  // Same as maskStr()
+  String &str = *d->_ext->writeStrObj;
+  unsigned int i=0; // which digit
+  unsigned int j=0; // which digit have it counted to
+  while(i<str.length() && j<digit){
+    if(str[i+1]=='.'){
+      i++;
+    }
+    i++;
+    j++;
   }
 
+  int mask = d->charMask(str[i]);
+  if(str[i+1]=='.') mask |= SEVENSEG_DP;
+  return mask;
+
+}
+
+int SevenSeg::maskProgmem(SevenSeg *d, byte digit){	// Animation frame read directly from program memory
+  return pgm_read_byte(d->_frame+digit);
+}
+
+int SevenSeg::maskFrame(SevenSeg *d, byte digit){	// Frames from queue or raw segment data
+  if(d->_frame) return d->_frame[digit];
+  return 0;
 }
 
 void SevenSeg::changeDigit(int digit){
 
 
-  // Turn off all digits/segments first.
+  // Turn off the active digit and any lit segments first. Only pins that are
+  // actually on are written, so the cost doesn't grow with the number of digits.
   // If you swith on a new digit before turning off the segments you will get
   // a slight shine of the "old" number in the "new" digit.
-  clearDisp();
-  digitalWrite(_dig[digit], _digOn);
+  digitOff();
+  clearSegs(0xFF);
+  digitOn(digit);
+  _curDigit=digit;
 
 }
 
@@ -702,15 +2731,23 @@ void SevenSeg::changeDigit(char digit){
 
   if(digit=='s'){
     // change to the symbol digit
-    clearDisp();
-    digitalWrite(_symbDigPin, _digOn);
-    digitalWrite(_colonSegPin, _colonState);
-    digitalWrite(_colonSegLPin, _colonState);
-    digitalWrite(_aposSegPin, _aposState);
+    digitOff();
+    clearSegs(0xFF);
+    pinWrite(_symbDigPin, _digOn);
+    pinWrite(_colonSegPin, _colonState);
+    pinWrite(_colonSegLPin, _colonState);
+    pinWrite(_aposSegPin, _aposState);
+    _curDigit=_numOfDigits;
+    _pinWrites+=4;
+
+    // The symbol segments may share pins with the other segments. Keep track of those lit.
+    if(_colonState==_segOn) _segLit |= pinMask(_colonSegPin) | pinMask(_colonSegLPin);
+    if(_aposState==_segOn) _segLit |= pinMask(_aposSegPin);
   }
 
   if(digit==' '){
-    clearDisp();
+    digitOff();
+    clearSegs(0xFF);
   }
 
 }
@@ -719,18 +2756,22 @@ void SevenSeg::setDPPin(int DPPin){
 
   _DP=DPPin;
   pinMode(_DP, OUTPUT);
+  pinWrite(_DP, _segOff);
+  portSetup();
 
 }
 
 void SevenSeg::setDP(){
 
-  digitalWrite(_DP, _segOn);
+  pinWrite(_DP, _segOn);
+  _segLit |= SEVENSEG_DP;
 
 }
 
 void SevenSeg::clearDP(){
 
-  digitalWrite(_DP, _segOff);
+  pinWrite(_DP, _segOff);
+  _segLit &= ~SEVENSEG_DP;
 
 }
 /*
@@ -813,7 +2854,7 @@ I've decided to treat the symbols in the following way
 void SevenSeg::setColonPin(int colonPin){
   _colonSegPin=colonPin;
   pinMode(_colonSegPin,OUTPUT);
-  digitalWrite(_colonSegPin, _colonState);
+  pinWrite(_colonSegPin, _colonState);
 }
 
 void SevenSeg::setSymbPins(int digPin, int segUCPin, int segLCPin, int segAPin){
@@ -827,9 +2868,9 @@ void SevenSeg::setSymbPins(int digPin, int segUCPin, int segLCPin, int segAPin){
   pinMode(_colonSegLPin,OUTPUT);
   pinMode(_aposSegPin,OUTPUT);
   pinMode(_symbDigPin,OUTPUT);
-  digitalWrite(_colonSegPin, _colonState);
-  digitalWrite(_colonSegLPin, _colonState);
-  digitalWrite(_aposSegPin, _aposState);
+  pinWrite(_colonSegPin, _colonState);
+  pinWrite(_colonSegLPin, _colonState);
+  pinWrite(_aposSegPin, _aposState);
 }
 
 /*
@@ -862,351 +2903,105 @@ changeDigit('s'). This function will light up the appropriate symbols in accorda
 void SevenSeg::setColon(){
   _colonState=_segOn;
   if(_symbDigPin==-1){
-    digitalWrite(_colonSegPin, _segOn);
+    pinWrite(_colonSegPin, _segOn);
   }
 }
 
 void SevenSeg::clearColon(){
   _colonState=_segOff;
   if(_symbDigPin==-1){
-    digitalWrite(_colonSegPin, _segOff);
+    pinWrite(_colonSegPin, _segOff);
   }
 }
 
 void SevenSeg::setApos(){
   _aposState=_segOn;
   if(_symbDigPin==-1){
-    digitalWrite(_aposSegPin, _segOn);
+    pinWrite(_aposSegPin, _segOn);
   }
 }
 
 void SevenSeg::clearApos(){
   _aposState=_segOff;
   if(_symbDigPin==-1){
-    digitalWrite(_aposSegPin, _segOff);
+    pinWrite(_aposSegPin, _segOff);
   }
 }
 
 void SevenSeg::writeDigit(int digit){
 
-  // Turn off all LEDs first to avoid running current through too many LEDs at once.
-  digitalWrite(_A, _segOff);
-  digitalWrite(_B, _segOff);
-  digitalWrite(_C, _segOff);
-  digitalWrite(_D, _segOff);
-  digitalWrite(_E, _segOff);
-  digitalWrite(_F, _segOff);
-  digitalWrite(_G, _segOff);
-
-  if(digit==1){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-  }
-
-  if(digit==2){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_G, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_D, _segOn);
-  }
-
-  if(digit==3){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_G, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-  }
-
-  if(digit==4){
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-  }
-
-  if(digit==5){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-  }
-
-  if(digit==6){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit==7){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-  }
-
-  if(digit==8){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit==9){
-    digitalWrite(_G, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-  }
-
-  if(digit==0){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
+  // Only the segments that differ from those lit now are written. Segments are turned off
+  // before others are turned on to avoid running current through too many LEDs at once.
+  writeSegs((_segLit & SEVENSEG_DP) | digitMask(digit));
 
 }
 
 void SevenSeg::writeDigit(char digit){
 
-  // Turn off all LEDs first. Run writeDigit(' ') to clear digit.
-  digitalWrite(_A, _segOff);
-  digitalWrite(_B, _segOff);
-  digitalWrite(_C, _segOff);
-  digitalWrite(_D, _segOff);
-  digitalWrite(_E, _segOff);
-  digitalWrite(_F, _segOff);
-  digitalWrite(_G, _segOff);
-
-  if(digit=='-'){
-    digitalWrite(_G, _segOn);
-  }
+  // Run writeDigit(' ') to clear digit.
+  writeSegs((_segLit & SEVENSEG_DP) | charMask(digit));
 
-  if(digit=='\370'){ // ASCII code 248 or degree symbol: '°'
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+}
 
-  // Digits are numbers. Write with writeDigit(int)
-  if(digit>=48&&digit<=57)  writeDigit(digit-48);
+// Returns the segments to light for the number "digit"
+int SevenSeg::digitMask(int digit){
 
-  // Digits are small caps letters. Capitalize.
-  if(digit>=97&&digit<=122) digit-=32;
+  if(digit<0 || digit>9) return 0;
+  return charMask((char)('0'+digit));
 
-  if(digit=='A'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+}
 
-  if(digit=='B'){
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+// Returns the segments to light for the character "digit"
+int SevenSeg::charMask(char digit){
 
-  if(digit=='C'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
+  byte c = (byte)digit;
 
-  if(digit=='D'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_G, _segOn);
+  if(_ext && _ext->font && (_fontWide || c<128)){
+    byte mask = pgm_read_byte(_ext->font+c);
+    if(mask) return mask;	// Zero entries fall back on the built-in font
   }
 
-  if(digit=='E'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+  return pgm_read_byte(SevenSegFont+c);
 
-  if(digit=='F'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+}
 
-  if(digit=='G'){
 /*
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_G, _segOn);
-    // TBD: Really write G like a 9, when it can be written as almost G?
-*/
-    digitalWrite(_A, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='H'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='I'){
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='J'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-  }
-
-  if(digit=='K'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='L'){
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='M'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-  }
-
-  if(digit=='N'){
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='O'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='P'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='Q'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='R'){
-    digitalWrite(_E, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='S'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='T'){
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
- if(digit=='U'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='V'){
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-  }
-
-  if(digit=='W'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_F, _segOn);
-  }
-
-  if(digit=='X'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
-
-  if(digit=='Y'){
-    digitalWrite(_B, _segOn);
-    digitalWrite(_C, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_F, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+ * FONTS
+ *
+ * Characters are looked up in a table of 256 segment masks in program memory, indexed by the character.
+ * Small caps letters are the same as capital letters, and the degree symbol is ASCII code 248 ('\370').
+ *
+ * setFont(font, size) adds a font with "size" (128 or 256) entries in program memory. Non-zero
+ * entries replace the built-in glyph whereas zero entries fall back on it, so a font need only contain the
+ * glyphs to add or change. setFont(0,0) removes it.
+ */
 
-  if(digit=='Z'){
-    digitalWrite(_A, _segOn);
-    digitalWrite(_B, _segOn);
-    digitalWrite(_D, _segOn);
-    digitalWrite(_E, _segOn);
-    digitalWrite(_G, _segOn);
-  }
+void SevenSeg::setFont(const byte *font, int size){
+  if(font==0 && _ext==0) return;	// Only the built-in font already
+  if(ext()==0) return;
+  _ext->font=font;
+  _fontWide=(size>=256);
 }
 
+const byte SevenSegFont[256] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x00-0x0F
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x10-0x1F
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00,	// 0x20-0x2F  ' '-'/'
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x30-0x3F  '0'-'?'
+  0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D, 0x76, 0x30, 0x1E, 0x76, 0x38, 0x15, 0x54, 0x3F,	// 0x40-0x4F  '@'-'O'
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x1C, 0x2A, 0x76, 0x6E, 0x5B, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x50-0x5F  'P'-'_'
+  0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D, 0x76, 0x30, 0x1E, 0x76, 0x38, 0x15, 0x54, 0x3F,	// 0x60-0x6F  '`'-'o'
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x1C, 0x2A, 0x76, 0x6E, 0x5B, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x70-0x7F  'p'-DEL
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x80-0x8F
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0x90-0x9F
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0xA0-0xAF
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0xB0-0xBF
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0xC0-0xCF
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0xD0-0xDF
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	// 0xE0-0xEF
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 	// 0xF0-0xFF
+};
+
 void SevenSeg::execDelay(int usec){
 
   if(usec!=0){	// delay() and delayMicroseconds() don't handle 0 delay
@@ -1246,9 +3041,19 @@ void SevenSeg::setTimer(int timerID){
     max delay for something to happen = 16us * (65535+1) = 1.04s
 
   which should be more than sufficient if you want to be able to look at your display.
+
+  SEVENSEG_TIMER0_SHARED shares timer0 with the Arduino core rather than taking it over, leaving
+  millis(), micros() and delay() working. The core runs timer0 in fast PWM mode with a prescaler of
+  64, overflowing every 1024us. Its configuration is left alone, and the compare B interrupt, which
+  triggers once per overflow period whatever OCR0B is, is used for multiplexing. Hence PWM on the
+  OC0B pin (analogWrite() on pin 5) keeps working too. The interrupt routine must be
+  ISR(TIMER0_COMPB_vect). The interrupt period is 64 times longer, so the on- and off-times are
+  resolved in steps of 1024us and each digit takes at least 2048us. This suits few digits and low
+  refresh rates. The slowdown of setIdle() has no effect since the period can't be changed.
 */
 
   _timerID = timerID;
+  _tickLen = (timerID==SEVENSEG_TIMER0_SHARED) ? 64 : 1;
 
 }
 
@@ -1261,10 +3066,15 @@ void SevenSeg::clearTimer(){
 
 void SevenSeg::startTimer(){
 
-  cli();  // Temporarily stop interrupts
+  byte sreg = lockInterrupts();  // Temporarily stop interrupts
 
   // See registers in ATmega328 datasheet
 
+  if(_timerID==SEVENSEG_TIMER0_SHARED){
+    TIFR0 = (1<<OCF0B);				// Clear any pending compare B interrupt
+    TIMSK0 |= (1<<OCIE0B);			// Enable timer compare B interrupt
+  }
+
   if(_timerID==0){
     TCCR0A = 0;
     TCCR0B = 0;
@@ -1295,15 +3105,20 @@ void SevenSeg::startTimer(){
     TIMSK2 |= (1 << OCIE2A);			// Enable timer compare interrupt
   }
 
-  sei();  // Continue allowing interrupts
+  unlockInterrupts(sreg);  // Restore the interrupt state
 
   // update delays to get reasonable values to _timerCounterOn/OffEnd.
   updDelay();
   _timerCounter=0;
 
+  wake();
+
 }
 
 void SevenSeg::stopTimer(){
+  if(_timerID==SEVENSEG_TIMER0_SHARED){
+    TIMSK0 &= ~(1<<OCIE0B);	// Timer0 keeps running for the Arduino core
+  }
   if(_timerID==0){
     TCCR0B = 0;
   }
@@ -1315,11 +3130,45 @@ void SevenSeg::stopTimer(){
   }
 }
 
+// Sets the interrupt period to "scale" times 16us, or stops the timer if "scale" is 0. Unlike
+// startTimer() and stopTimer() this may be called from interruptAction().
+void SevenSeg::setTick(int scale){
+
+  if(_timerID==SEVENSEG_TIMER0_SHARED){	// The period can't be changed. Only enable or disable.
+    if(scale) TIMSK0 |= (1<<OCIE0B);
+    else TIMSK0 &= ~(1<<OCIE0B);
+  }
+
+  if(_timerID==0){
+    if(scale) OCR0A = 4*scale-1;
+    TCNT0 = 0;
+    TCCR0B = scale ? (1<<CS01) | (1<<CS00) : 0;
+  }
+
+  if(_timerID==1){
+    if(scale) OCR1A = 4*scale-1;
+    TCNT1 = 0;
+    TCCR1B = scale ? (1 << WGM12) | (1 << CS11) | (1 << CS10) : 0;
+  }
+
+  if(_timerID==2){
+    if(scale) OCR2A = 4*scale-1;
+    TCNT2 = 0;
+    TCCR2B = scale ? (1 << CS22) : 0;
+  }
+
+}
+
+#elif defined(__linux__)
+
+// Implemented using a timer thread in SevenSegLinux.cpp
+
 #else
 
 void SevenSeg::setTimer(int timerID){}
 void SevenSeg::clearTimer(){}
 void SevenSeg::startTimer(){}
 void SevenSeg::stopTimer(){}
+void SevenSeg::setTick(int scale){}
 
 #endif
@@ -24,6 +24,107 @@
 
 #include "Arduino.h"
 
+class SevenSegBus;
+#if defined(__linux__)
+class SevenSegGpio;
+#endif
+
+// Type used for storing pin numbers. -1 means not assigned.
+#if defined(__linux__)
+typedef int SevenSegPin;	// GPIO line offsets may be large
+#else
+typedef signed char SevenSegPin;
+#endif
+
+// Bits for each segment in segment masks
+#define SEVENSEG_A 0x01
+#define SEVENSEG_B 0x02
+#define SEVENSEG_C 0x04
+#define SEVENSEG_D 0x08
+#define SEVENSEG_E 0x10
+#define SEVENSEG_F 0x20
+#define SEVENSEG_G 0x40
+#define SEVENSEG_DP 0x80
+
+// Bits for the symbols in segment masks
+#define SEVENSEG_COLON 0x01
+#define SEVENSEG_APOS 0x02
+
+// Timer ID for setTimer() sharing timer0 with the Arduino core through its compare B interrupt
+#define SEVENSEG_TIMER0_SHARED 16
+
+// Scan orders for setScanOrder()
+#define SEVENSEG_SCAN_SEQUENTIAL 0
+#define SEVENSEG_SCAN_INTERLEAVED 1
+#define SEVENSEG_SCAN_BITREVERSED 2
+
+// Built-in font. Segment masks for each character.
+extern const byte SevenSegFont[256] PROGMEM;
+
+// Maximum number of digits in a frame of segment masks, and number of frames in SevenSegQueue
+// (must be a power of two)
+#ifndef SEVENSEG_MAX_DIGITS
+#define SEVENSEG_MAX_DIGITS 8
+#endif
+#ifndef SEVENSEG_QUEUE_LENGTH
+#define SEVENSEG_QUEUE_LENGTH 8
+#endif
+
+// Maximum number of pages for SevenSeg::addPage()
+#ifndef SEVENSEG_MAX_PAGES
+#define SEVENSEG_MAX_PAGES 4
+#endif
+
+// Maximum number of return pins for SevenSeg::setKeyPins(), and number of key events buffered (must be
+// a power of two)
+#ifndef SEVENSEG_MAX_KEY_PINS
+#define SEVENSEG_MAX_KEY_PINS 4
+#endif
+#ifndef SEVENSEG_KEY_EVENTS
+#define SEVENSEG_KEY_EVENTS 8
+#endif
+
+// Flag added to the key number in events from SevenSeg::getKeyEvent() when the key is released
+#define SEVENSEG_KEY_RELEASE 0x40
+
+/*
+ * Lock-free queue of frames for SevenSeg::setQueue(). Each frame holds one segment mask per digit
+ * and how many display frames (refresh periods) to show it. There must be only one producer calling
+ * push(), which may be the main loop or another interrupt routine, and interruptAction() is the
+ * only consumer. Neither needs to disable interrupts.
+ */
+class SevenSegQueue
+{
+
+  public:
+
+    SevenSegQueue();
+
+    int push(const byte *masks, int count, unsigned int hold);	// Returns 1 if queued, 0 if full
+    int available();		// Number of frames that can be pushed without overflow
+    unsigned int overflows();	// Frames pushed while full (and dropped)
+    unsigned int underflows();	// Times a frame was shown to its end with no new frame queued
+
+    const byte *nextFrame();	// Used by interruptAction() at the start of each display frame
+
+  private:
+
+    struct Frame {
+      byte masks[SEVENSEG_MAX_DIGITS];
+      unsigned int hold;
+    };
+
+    Frame _frames[SEVENSEG_QUEUE_LENGTH];
+    volatile byte _head;	// Next frame to push. Only written by the producer.
+    volatile byte _tail;	// Frame being shown. Only written by the consumer.
+    byte _started;		// Whether the frame at _tail is being shown
+    byte _waiting;		// Whether an underflow has been counted for the frame being shown
+    unsigned int _hold;		// Display frames left of the frame being shown
+    volatile unsigned int _overflows;
+    volatile unsigned int _underflows;
+
+};
+
 class SevenSeg
 {
 
@@ -35,7 +136,7 @@ class SevenSeg
     // Low level functions for initializing hardware
     void setCommonAnode();
     void setCommonCathode();
-    void setDigitPins(int,int *);
+    int setDigitPins(int,int *);
     void setActivePinState(int,int);
     void setDPPin(int);
     void setColonPin(int);
@@ -47,6 +148,8 @@ class SevenSeg
     void changeDigit(char);
     void writeDigit(int);
     void writeDigit(char);
+    int charMask(char);
+    void setFont(const byte *,int);
     void setDP();
     void clearDP();
     void setColon();
@@ -58,6 +161,40 @@ class SevenSeg
     void setDigitDelay(long int);	// Should I have this function?
     void setRefreshRate(int);
     void setDutyCycle(int);
+    void setScanOrder(int);
+    void setScanOrder(const byte *,int);
+    void setPortOutput(int);
+    void fadeTo(int,unsigned int);
+    int fadeDone();
+
+    // Frame queue (requires a timer)
+    void setQueue(SevenSegQueue *);
+
+    // Animations stored in program memory (requires a timer)
+    void playAnimation(const byte *,int,int,int);
+    int animationDone();
+
+    // Power saving (requires a timer)
+    void setAutoStop(int);
+    void setIdle(unsigned int,int);
+    unsigned long int getActiveTime();
+    unsigned long int getIdleTime();
+
+    // Pages (requires a timer for flipping)
+    int addPage(const byte *);
+    void showPage(int);
+    void setPageTime(unsigned int);
+    int getPage();
+
+    // Keypad on the digit lines (requires a timer)
+    void setKeyPins(int,int *);
+    unsigned long int getKeys();
+    int getKeyEvent();
+
+    // Capacity planning
+    int getIsrLoad();
+    int getDutyStep();
+    int setCpuBudget(int);
 
     // High level functions for printing to display
     void write(long int);
@@ -72,6 +209,30 @@ class SevenSeg
     void writeClock(int,int);
     void writeClock(int,char);
     void writeClock(int);
+    void writeHex(unsigned long int);
+    void writeHex(unsigned long int,int,int);
+    void writeBin(unsigned long int);
+    void writeBin(unsigned long int,int,int);
+    void writeBytes(const byte *,int);
+    void writeSegments(const byte *,int);
+    void writeSegmentsRef(const byte *,int);
+
+    // Rendering into segment masks
+    byte *getFrame();
+    void renderInt(byte *,int,long int,int);
+    void renderStr(byte *,int,const char *);
+    void renderClock(byte *,int,int,int,char);
+    void renderRadix(byte *,int,unsigned long int,int,int);
+
+    // Self-running clock functions (requires a timer)
+    void setClock(int,int);
+    void setClock(int,int,char);
+    void setClockStep(int);
+    void setClockDir(int);
+    void startClock();
+    void stopClock();
+    void resetClock();
+    int clockZero();
 
     // Timer control functions
     void setTimer(int);
@@ -80,6 +241,19 @@ class SevenSeg
     void startTimer();
     void stopTimer();
 
+#if defined(__linux__)
+    // Linux host backend (see SevenSegLinux.h)
+    void setGpio(SevenSegGpio *);
+#endif
+
+    // Instrumentation
+    int getFrameTransitions();
+
+    // Frame synchronization (requires a timer)
+    void setFrameCallback(void (*)());
+    unsigned long int frameCount();
+    void waitForFrame();
+
     // To clean up
 //  void setPinState(int);	// I think this isn't in use. Its called setActivePinState?
 //  int getDigitDelay();	// How many get-functions should I make?
@@ -87,22 +261,22 @@ class SevenSeg
   private:
 
     // The pins for each of the seven segments (eight with decimal point)
-    int _A;
-    int _B;
-    int _C;
-    int _D;
-    int _E;
-    int _F;
-    int _G;
-    int _DP;	// -1 when decimal point not assigned
+    SevenSegPin _A;
+    SevenSegPin _B;
+    SevenSegPin _C;
+    SevenSegPin _D;
+    SevenSegPin _E;
+    SevenSegPin _F;
+    SevenSegPin _G;
+    SevenSegPin _DP;	// -1 when decimal point not assigned
 
     // Variables used for colon and apostrophe symbols
-    int _colonState;	// Whether colon is on (_segOn) or off (_segOff).
-    int _aposState;	// Whether apostorphe is on (_segOn) or off (_segOff).
-    int _colonSegPin;
-    int _colonSegLPin;
-    int _aposSegPin;
-    int _symbDigPin;
+    byte _colonState;	// Whether colon is on (_segOn) or off (_segOff).
+    byte _aposState;	// Whether apostorphe is on (_segOn) or off (_segOff). Not a bit field since interruptAction() writes it.
+    SevenSegPin _colonSegPin;
+    SevenSegPin _colonSegLPin;
+    SevenSegPin _aposSegPin;
+    SevenSegPin _symbDigPin;
 
     /* The colon/apostrophe handling needs some further explanation:
      *
@@ -128,46 +302,142 @@ class SevenSeg
      */
 
     // The pins for each of the digits
-    int *_dig;
-    int _numOfDigits;
+    SevenSegPin _dig[SEVENSEG_MAX_DIGITS];
+    byte _numOfDigits;
+
+    // Output state tracking. Lets changeDigit() and writeDigit() write only the pins that actually need
+    // to change rather than every digit and segment pin.
+    signed char _curDigit;	// Digit currently switched on (-1 for none, _numOfDigits for the symbol digit)
+    byte _segLit;		// Segments currently lit. Bits 0-6 are segments A-G, bit 7 is DP.
+    unsigned int _pinWrites;	// Pins written by interruptAction() so far in this frame
+    unsigned int _framePinWrites;	// Pins written by interruptAction() during the last complete frame
+    void pinWrite(int,int);
+    void digitOff();
+    void clearSegs(int);
+    void writeSegs(int);
+    void digitOn(int);
+    int pinMask(int);
+    int digitMask(int);
 
     // Timing variables. Stored in microseconds.
     long int _digitDelay;		// How much time spent per display during multiplexing.
     long int _digitOnDelay;		// How much on-time per display (used for dimming), i.e. it could be on only 40% of digitDelay
     long int _digitOffDelay;		// digitDelay minus digitOnDelay
-    int _dutyCycle;		// The duty cycle (digitOnDelay/digitDelay, here in percent)
+    byte _dutyCycle;		// The duty cycle (digitOnDelay/digitDelay, here in percent)
     // Strictly speaking, _digitOnDelay and _digitOffDelay holds redundant information, but are stored so the computations only
     // needs to be made once. There's an internal update function to update them based on the _digitDelay and _dutyCycle
 
     void updDelay();
+    void phaseEnds(int,unsigned int &,unsigned int &);
     void execDelay(int);	// Executes delay in microseconds
     char iaExtractDigit(long int,int,int);
     long int iaLimitInt(long int);
 
-    // Sets which values (HIGH or LOW) pins should have to turn on/off segments or digits.
-    // This depends on whether the display is Common Anode or Common Cathode.
-    int _digOn;
-    int _digOff;
-    int _segOn;
-    int _segOff;
+    // Flags never written by interruptAction(), packed into one byte. Writing one of them reads and
+    // writes the whole byte, so flags written by interruptAction() must not be added here.
+    // _digOn/_digOff/_segOn/_segOff sets which values (HIGH or LOW) pins should have to turn on/off
+    // segments or digits. This depends on whether the display is Common Anode or Common Cathode.
+    byte _digOn:1;
+    byte _digOff:1;
+    byte _segOn:1;
+    byte _segOff:1;
+    byte _fontWide:1;	// Whether _font has 256 rather than 128 characters
+    byte _clockActive:1;	// Whether the clock writing mode shows the self-running clock rather than _writeInt
+    byte _rawSymb:1;		// Whether raw segment data has a symbol mask after the digits
 
     // Variables used by interrupt service routine to keep track of stuff
-    int _timerDigit;		// What digit interrupt timer should update next time
-    int _timerPhase;		// What phase of the cycle it is to update, i.e. phase 1 (on), or phase 0 (off). Needed for duty cycling.
-    int _timerID;		// Values 0,1,2 corresponds to using timer0, timer1 or timer2.
-    long int _timerCounter;		// Prescaler of 64 is used since this is available on all timers (0, 1 and 2).
+    byte _timerDigit;		// What digit interrupt timer should update next time
+    byte _timerPhase;		// What phase of the cycle it is to update, i.e. phase 1 (on), or phase 0 (off). Needed for duty cycling.
+    signed char _timerID;	// Values 0,1,2 corresponds to using timer0, timer1 or timer2.
+    byte _tickLen;		// Interrupt period in units of 16us. 64 when sharing timer0.
+    unsigned int _timerCounter;		// Prescaler of 64 is used since this is available on all timers (0, 1 and 2).
 				// Timer registers are not sufficiently large. This counter variable will extend upon the original timer.
 				// and increment by one each time.
-    long int _timerCounterOnEnd;	// How far _timerCounter should count to provide a delay approximately equal to _digitOnDelay
-    long int _timerCounterOffEnd;	// How far _timerCounter should count to provide a delay approximately equal to _digitOffDelay
+    unsigned int _timerCounterOnEnd;	// How far _timerCounter should count to provide a delay approximately equal to _digitOnDelay
+    unsigned int _timerCounterOffEnd;	// How far _timerCounter should count to provide a delay approximately equal to _digitOffDelay
+
+#if defined(__linux__)
+    SevenSegGpio *_gpio;	// Writes the pins instead of digitalWrite() when assigned
+    void *_hostTimer;		// Timer thread state. Only used in SevenSegLinux.cpp.
+#endif
+
+    // Windows, pages and print buffers look up the number of digits (see SevenSegWindow.h)
+    friend class SevenSegWindow;
+    friend class SevenSegPrint;
+    static long int roundFixed(double,int);
+    char clockSeparator();
+
+    // Shared segment lines (see SevenSegBus.h)
+    friend class SevenSegBus;
+    SevenSegBus *_bus;		// Bus multiplexing this display along with others, 0 if none
+    void multiplex();
+    int phaseEnded();
+    int switchPhase();
+    void scanDigit();
+    void countTicks(byte);
+    void keepTime(byte);
+
+#if defined(__AVR__)
+    // The timer interrupt may be interrupted while switching digits (see multiplex())
+    volatile byte _isrNest;	// 0 when not switching, otherwise 1 plus the number of ticks to count when done
+#endif
 
     // What is to be printed by interruptAction is determined by these variables
     long int _writeInt;		// Holds the number to be written in case of int, fixed point, or clock
-    int _writePoint;		// Holds the number of digits to use as decimals in case of fixed point
+    signed char _writePoint;	// Holds the number of digits to use as decimals in case of fixed point
 //    float _writeFloat;		// Holds the float to write in case of float. OBSOLETE: Float are converted to fixed point
     char *_writeStr;		// Holds a pointer to a string to write in case of string
     char _writeMode;		// 'p' for fixed point, 'i' for integer, 'f' for float, ':'/'.'/'_' for clock with according divisor symbol
-    String _writeStrObj;
+    typedef int (*MaskFn)(SevenSeg *,byte);
+    typedef void (*FrameFn)(SevenSeg *);
+    MaskFn _maskFn;		// Computes the segment mask of a digit in the current write mode, 0 for none
+    const byte *_frame;		// Segment masks being shown in case of queue, animation or raw segment data
+    void writeSymbols(byte);
+    void writeRadix(unsigned long int,int,int,int);
+    void setMode(char,MaskFn,FrameFn=0);
+    static int maskFixed(SevenSeg *,byte);
+    static int maskInt(SevenSeg *,byte);
+    static int maskClock(SevenSeg *,byte);
+    static int maskStr(SevenSeg *,byte);
+    static int maskString(SevenSeg *,byte);
+    static int maskProgmem(SevenSeg *,byte);
+    static int maskFrame(SevenSeg *,byte);
+    static void queueStep(SevenSeg *);
+    static void animStep(SevenSeg *);
+    static void pageStep(SevenSeg *);
+
+    // State of features not in use take no more RAM than a pointer. They are allocated when first used.
+    struct Animation;
+    struct Clock;
+    struct Power;
+    struct Scan;
+    struct Sync;
+    struct Fade;
+    struct Pages;
+    struct Keys;
+#if defined(__AVR__)
+    struct Port;
+    void portWrite(volatile uint8_t *,byte,byte);
+#endif
+    struct Ext;
+    Ext *_ext;			// Optional feature state (see ext()), 0 while none is in use
+    Ext *ext();
+
+    Clock *clockState();
+    static void clockTick(Clock *);
+    Power *powerState();
+    void powerSwitch(byte);
+    static int powerCheck(SevenSeg *);
+    static void powerWake(SevenSeg *);
+    void wake();
+    void setTick(int);
+    void scanTable();
+    void scanTable(byte);
+    void scanSet(const Scan &);
+    void portSetup();
+    Sync *syncState();
+    static void fadeStep(SevenSeg *);
+    static void keyScan(SevenSeg *,byte);
 
 };
 
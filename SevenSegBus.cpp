@@ -0,0 +1,167 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegBus.cpp - Several SevenSeg displays sharing segment lines
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Arduino.h"
+#include "SevenSegBus.h"
+#if defined(__linux__)
+#include "SevenSegLinux.h"
+#endif
+
+// Constructor
+SevenSegBus::SevenSegBus(){
+  _count=0;
+  _cur=0;
+#if defined(__AVR__)
+  _isrNest=0;
+#endif
+}
+
+// Adds a display to the bus and returns its position in the scan, or -1 if the bus is full. The
+// displays are multiplexed in the order they're added.
+int SevenSegBus::add(SevenSeg &disp){
+
+  if(_count>=SEVENSEG_MAX_BUS_DISPLAYS) return -1;
+
+  cli();
+  disp._bus=this;
+  disp._timerDigit=0;
+  disp._timerPhase=1;
+  disp._timerCounter=0;
+  _disps[_count]=&disp;
+  sei();
+
+  return _count++;
+
+}
+
+// Sets the refresh rate of all displays, i.e. how many times per second each digit on the bus is lit
+void SevenSegBus::setRefreshRate(int freq){
+
+  int digits = 0;
+  for(int i=0;i<_count;i++){
+    digits += _disps[i]->_numOfDigits;
+    if(_disps[i]->_symbDigPin!=-1) digits++;
+  }
+  if(digits==0) return;
+
+  long int digitDelay = 1000000L/freq/digits;
+  for(int i=0;i<_count;i++) _disps[i]->setDigitDelay(digitDelay);
+
+}
+
+// The timer is assigned to all displays, such that their write functions leave the multiplexing to the
+// timer, but only the first display starts and stops it.
+void SevenSegBus::setTimer(int timerID){
+  for(int i=0;i<_count;i++) _disps[i]->setTimer(timerID);
+}
+
+void SevenSegBus::clearTimer(){
+  for(int i=0;i<_count;i++) _disps[i]->clearTimer();
+}
+
+void SevenSegBus::startTimer(){
+
+  if(_count==0) return;
+
+  for(int i=0;i<_count;i++){
+    SevenSeg *d = _disps[i];
+    d->updDelay();
+    d->_timerDigit=0;
+    d->_timerPhase=1;
+    d->_timerCounter=0;
+  }
+
+  // Start the scan with the first digit of the first display
+  _cur=0;
+  _disps[0]->scanDigit();
+  _disps[0]->startTimer();
+
+}
+
+void SevenSegBus::stopTimer(){
+
+  if(_count==0) return;
+
+  _disps[0]->stopTimer();
+
+}
+
+// Does the work of one timer interrupt, like SevenSeg::multiplex() for a display not on a bus
+void SevenSegBus::interruptAction(){
+
+  if(_count==0) return;
+
+#if defined(__AVR__)
+  // Interrupted by the timer while switching digits or handing over below. Only note the tick, and
+  // leave it to be counted when done.
+  if(_isrNest){
+    if(_isrNest<255) _isrNest++;
+    return;
+  }
+#endif
+
+  countTicks(1);
+
+  // Nothing more to do until the phase of the display being multiplexed has ended
+  SevenSeg *d = _disps[_cur];
+  if(!d->phaseEnded()) return;
+
+#if defined(__AVR__)
+  // Switch digits, and hand over to the next display, with interrupts enabled (see SevenSeg::multiplex())
+  byte sreg = SREG;
+  _isrNest=1;
+  sei();
+#endif
+
+  if(d->switchPhase()){
+
+    // The display has finished its frame with all digits off. The next display takes over the segment
+    // lines as they are and switches on its first digit.
+    byte next = _cur+1;
+    if(next>=_count) next=0;
+
+    SevenSeg *n = _disps[next];
+    n->_segLit=d->_segLit;
+    n->scanDigit();
+    _cur=next;
+
+  }
+
+#if defined(__AVR__)
+  cli();
+  if(_isrNest>1) countTicks(_isrNest-1);
+  _isrNest=0;
+  SREG = sreg;
+#endif
+
+}
+
+// Counts "ticks" interrupts. The clocks, animations, pages and power saving of all displays keep time,
+// not only those of the display being multiplexed, which also counts its phase.
+void SevenSegBus::countTicks(byte ticks){
+
+  for(byte i=0;i<_count;i++){
+    if(i==_cur) _disps[i]->countTicks(ticks);
+    else _disps[i]->keepTime(ticks);
+  }
+
+}
@@ -0,0 +1,95 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegBus.h - Several SevenSeg displays sharing segment lines
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Displays whose digits have separate common pins but share the segment lines can't be multiplexed
+ * independently, since they would drive the segment lines at the same time. A bus multiplexes them in
+ * turn with one timer, as if their digits were one long display: each display shows a whole frame,
+ * and then hands the segment lines over to the next one. Each display is constructed with the same
+ * segment pins and keeps its own write functions, duty cycle and frame features (queue, pages, fades,
+ * etc.). The segments lit when a display hands over are known to the next one, such that only the
+ * segments differing on its first digit are written.
+ *
+ *   SevenSeg left(2,3,4,5,6,7,8);
+ *   SevenSeg right(2,3,4,5,6,7,8);
+ *   SevenSegBus bus;
+ *
+ *   left.setDigitPins(4,leftPins);
+ *   right.setDigitPins(4,rightPins);
+ *   bus.add(left);
+ *   bus.add(right);
+ *   bus.setRefreshRate(100);	// Every digit of both displays 100 times per second
+ *   bus.setTimer(2);
+ *   bus.startTimer();
+ *
+ *   ISR(TIMER2_COMPA_vect){
+ *     left.interruptAction();	// Any display on the bus, or bus.interruptAction()
+ *   }
+ *
+ * Every display counts every interrupt, so self-running clocks, animations and page flipping keep
+ * their time while other displays are being shown. The displays must have the same segment polarity
+ * (common anode or cathode). The power saving of setAutoStop() and setIdle() is not used on a bus,
+ * since the timer is shared.
+ */
+
+#ifndef SevenSegBus_h
+#define SevenSegBus_h
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+
+// Maximum number of displays on a bus
+#ifndef SEVENSEG_MAX_BUS_DISPLAYS
+#define SEVENSEG_MAX_BUS_DISPLAYS 4
+#endif
+
+class SevenSegBus
+{
+
+  public:
+
+    // Constructor
+    SevenSegBus();
+
+    int add(SevenSeg &);
+    void setRefreshRate(int);
+
+    // Timer control functions
+    void setTimer(int);
+    void clearTimer();
+    void startTimer();
+    void stopTimer();
+    void interruptAction();
+
+  private:
+
+    SevenSeg *_disps[SEVENSEG_MAX_BUS_DISPLAYS];
+    byte _count;
+    volatile byte _cur;		// Display being multiplexed
+#if defined(__AVR__)
+    volatile byte _isrNest;	// Like SevenSeg::_isrNest, for the bus as a whole
+#endif
+
+    void countTicks(byte);
+
+};
+
+#endif
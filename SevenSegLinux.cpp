@@ -0,0 +1,297 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegLinux.cpp - Linux host backend for SevenSeg
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__linux__)
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegLinux.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <linux/gpio.h>
+
+/*
+ * CRITICAL SECTION
+ */
+
+static pthread_mutex_t sevenSegMutex;
+static pthread_once_t sevenSegMutexOnce = PTHREAD_ONCE_INIT;
+
+static void sevenSegMutexInit(){
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&sevenSegMutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+void sevenSegLock(){
+  pthread_once(&sevenSegMutexOnce, sevenSegMutexInit);
+  pthread_mutex_lock(&sevenSegMutex);
+}
+
+void sevenSegUnlock(){
+  pthread_mutex_unlock(&sevenSegMutex);
+}
+
+/*
+ * TIMER THREAD
+ */
+
+struct SevenSegHostTimer {
+  pthread_t thread;
+  int fd;			// timerfd expiring every 16us
+  volatile int run;
+  SevenSeg *disp;
+};
+
+static void *sevenSegTimerThread(void *arg){
+
+  SevenSegHostTimer *t = (SevenSegHostTimer *)arg;
+
+  while(t->run){
+
+    // Blocks until the timer has expired at least once. If the thread has been delayed the
+    // timer may have expired several times. Run interruptAction() for each of them to keep
+    // the timing right.
+    uint64_t expirations;
+    if(read(t->fd, &expirations, sizeof(expirations))!=sizeof(expirations)) continue;
+
+    while(expirations-- && t->run){
+      sevenSegLock();	// Like an interrupt, keeps the main thread out of cli()/sei() sections
+      t->disp->interruptAction();
+      sevenSegUnlock();
+    }
+
+  }
+
+  return 0;
+
+}
+
+void SevenSeg::setTimer(int timerID){
+
+  // Any timerID is accepted since the thread doesn't use any hardware timer
+  _timerID = timerID;
+
+}
+
+void SevenSeg::clearTimer(){
+
+  stopTimer();
+  _timerID = -1;
+
+}
+
+void SevenSeg::startTimer(){
+
+  if(_hostTimer) stopTimer();
+
+  SevenSegHostTimer *t = new SevenSegHostTimer;
+  t->disp = this;
+  t->run = 1;
+  t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if(t->fd<0){
+    delete t;
+    return;
+  }
+
+  // update delays to get reasonable values to _timerCounterOn/OffEnd.
+  updDelay();
+  _timerCounter=0;
+
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = 0;
+  spec.it_interval.tv_nsec = 16000;	// 16us like the AVR timers
+  spec.it_value = spec.it_interval;
+  timerfd_settime(t->fd, 0, &spec, 0);
+
+  // Prefer real-time scheduling, but fall back on normal scheduling if not permitted
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+  pthread_attr_setschedparam(&attr, &param);
+
+  if(pthread_create(&t->thread, &attr, sevenSegTimerThread, t)!=0){
+    if(pthread_create(&t->thread, 0, sevenSegTimerThread, t)!=0){
+      close(t->fd);
+      delete t;
+      t = 0;
+    }
+  }
+
+  pthread_attr_destroy(&attr);
+
+  _hostTimer = t;
+
+  wake();
+
+}
+
+void SevenSeg::stopTimer(){
+
+  SevenSegHostTimer *t = (SevenSegHostTimer *)_hostTimer;
+  if(!t) return;
+
+  t->run = 0;
+  setTick(1);	// The thread may be waiting for a stopped timer
+  pthread_join(t->thread, 0);
+  close(t->fd);
+  delete t;
+  _hostTimer = 0;
+
+}
+
+// Sets the interrupt period to "scale" times 16us, or stops the timer if "scale" is 0
+void SevenSeg::setTick(int scale){
+
+  SevenSegHostTimer *t = (SevenSegHostTimer *)_hostTimer;
+  if(!t) return;
+
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = 0;
+  spec.it_interval.tv_nsec = 16000L*scale;	// Disarms the timer when 0
+  spec.it_value = spec.it_interval;
+  timerfd_settime(t->fd, 0, &spec, 0);
+
+}
+
+void SevenSeg::setGpio(SevenSegGpio *gpio){
+  _gpio = gpio;
+}
+
+/*
+ * GPIO CHARACTER DEVICE
+ */
+
+SevenSegGpioChip::SevenSegGpioChip(){
+  _fd = -1;
+  _count = 0;
+}
+
+SevenSegGpioChip::~SevenSegGpioChip(){
+  end();
+}
+
+int SevenSegGpioChip::begin(const char *path, int count, const int *lines){
+
+  end();
+
+  if(count<1 || count>GPIO_V2_LINES_MAX) return -1;
+
+  int chip = open(path, O_RDWR | O_CLOEXEC);
+  if(chip<0) return -1;
+
+  // Request all lines as outputs at once, so they can be written in one request later
+  struct gpio_v2_line_request req;
+  memset(&req, 0, sizeof(req));
+  for(int i=0;i<count;i++){
+    req.offsets[i] = lines[i];
+    _lines[i] = lines[i];
+  }
+  req.num_lines = count;
+  req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+  strncpy(req.consumer, "SevenSeg", sizeof(req.consumer)-1);
+
+  int ret = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req);
+  close(chip);
+  if(ret<0) return -1;
+
+  _fd = req.fd;
+  _count = count;
+
+  return 0;
+
+}
+
+void SevenSegGpioChip::end(){
+
+  if(_fd>=0) close(_fd);
+  _fd = -1;
+  _count = 0;
+
+}
+
+void SevenSegGpioChip::writeLines(int count, const int *pins, const int *values){
+
+  struct gpio_v2_line_values v;
+  v.mask = 0;
+  v.bits = 0;
+
+  for(int i=0;i<count;i++){
+    for(int j=0;j<_count;j++){
+      if(_lines[j]==pins[i]){
+        v.mask |= (uint64_t)1<<j;
+        if(values[i]) v.bits |= (uint64_t)1<<j;
+        break;
+      }
+    }
+  }
+
+  if(_fd>=0 && v.mask) ioctl(_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v);
+
+}
+
+/*
+ * IN-MEMORY GPIO
+ */
+
+SevenSegGpioMem::SevenSegGpioMem(){
+  for(int i=0;i<64;i++) _values[i] = LOW;
+  _writes = 0;
+  _requests = 0;
+}
+
+void SevenSegGpioMem::writeLines(int count, const int *pins, const int *values){
+
+  for(int i=0;i<count;i++){
+    if(pins[i]>=0 && pins[i]<64) _values[pins[i]] = values[i];
+  }
+
+  _writes += count;
+  _requests++;
+
+}
+
+int SevenSegGpioMem::read(int pin){
+  if(pin<0 || pin>=64) return LOW;
+  return _values[pin];
+}
+
+long int SevenSegGpioMem::writes(){
+  return _writes;
+}
+
+long int SevenSegGpioMem::requests(){
+  return _requests;
+}
+
+#endif
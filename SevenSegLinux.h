@@ -0,0 +1,129 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegLinux.h - Linux host backend for SevenSeg
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * On Linux the timer functions (setTimer(), startTimer(), stopTimer() and clearTimer()) run
+ * interruptAction() every 16us from a dedicated thread paced by a timerfd. The thread is given
+ * real-time priority if permitted.
+ *
+ * The pins may be written through a GPIO backend assigned with setGpio() rather than through
+ * digitalWrite(). The backend gets all segments changed on a digit switch in one call, such that
+ * they may be written in one request. SevenSegGpioChip drives the lines through the GPIO
+ * character device (/dev/gpiochipN), where the pin numbers are the line offsets of the chip.
+ * SevenSegGpioMem keeps the line values in memory and can be used to run the library on any
+ * Linux machine without hardware.
+ *
+ * The timer thread runs interruptAction() while holding a recursive mutex, and cli() and sei() lock
+ * and unlock the same mutex in the library and in sketches including this header. Code protected
+ * from interrupts on the AVR is therefore protected from the timer thread as well. Unlike on the
+ * AVR, every cli() must be matched by a sei() in the same thread, and stopTimer() must not be
+ * called between them.
+ *
+ * extras/linux holds an Arduino.h for building on a plain Linux machine, and tests using it.
+ *
+ * Example:
+ *
+ *   SevenSeg disp(0,1,2,3,4,5,6);
+ *   SevenSegGpioChip gpio;
+ *   int lines[11]={0,1,2,3,4,5,6,7,8,9,10};
+ *   int digitPins[4]={7,8,9,10};
+ *
+ *   gpio.begin("/dev/gpiochip0",11,lines);
+ *   disp.setGpio(&gpio);
+ *   disp.setDigitPins(4,digitPins);
+ *   disp.setTimer(0);
+ *   disp.startTimer();
+ */
+
+#ifndef SevenSegLinux_h
+#define SevenSegLinux_h
+
+#if defined(__linux__)
+
+#include "SevenSeg.h"
+
+// Critical section shared with the timer thread. May be nested.
+void sevenSegLock();
+void sevenSegUnlock();
+
+#undef cli
+#undef sei
+#define cli() sevenSegLock()
+#define sei() sevenSegUnlock()
+
+// Interface for writing the pins used by SevenSeg
+class SevenSegGpio
+{
+
+  public:
+
+    virtual ~SevenSegGpio(){}
+
+    // Sets pins[i] to values[i] (HIGH or LOW) for count pins
+    virtual void writeLines(int count, const int *pins, const int *values) = 0;
+
+};
+
+// Writes the pins through the Linux GPIO character device
+class SevenSegGpioChip : public SevenSegGpio
+{
+
+  public:
+
+    SevenSegGpioChip();
+    ~SevenSegGpioChip();
+
+    int begin(const char *path, int count, const int *lines);	// Returns 0 on success, -1 on failure
+    void end();
+    void writeLines(int count, const int *pins, const int *values);
+
+  private:
+
+    int _fd;			// File descriptor of the line request, -1 when not requested
+    int _count;
+    int _lines[64];		// Requested line offsets. Index is the bit in the request's value mask.
+
+};
+
+// Keeps the pin values in memory. For running and testing without hardware.
+class SevenSegGpioMem : public SevenSegGpio
+{
+
+  public:
+
+    SevenSegGpioMem();
+
+    void writeLines(int count, const int *pins, const int *values);
+    int read(int pin);
+    long int writes();		// Number of pins written
+    long int requests();	// Number of calls to writeLines()
+
+  private:
+
+    volatile int _values[64];
+    volatile long int _writes;
+    volatile long int _requests;
+
+};
+
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegPage.cpp - Pre-rendered pages for SevenSeg displays
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Arduino.h"
+#include "SevenSegPage.h"
+
+// Constructor
+SevenSegPage::SevenSegPage(SevenSeg &disp, int width) : SevenSegWindow(disp,_masks,width){
+
+  for(int i=0;i<=SEVENSEG_MAX_DIGITS;i++) _masks[i]=0;
+
+  _page=disp.addPage(_masks);
+
+}
+
+// Returns the page number to use with SevenSeg::showPage()
+int SevenSegPage::page(){
+  return _page;
+}
@@ -0,0 +1,65 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegPage.h - Pre-rendered pages for SevenSeg displays
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * A page holds the segment masks of a whole display of "width" digits (the display's number of digits)
+ * and registers itself with the display using SevenSeg::addPage(). A page is a SevenSegWindow covering
+ * the whole display, which renders into the page only, and keeps the symbol mask after the display's
+ * last digit. The display shows the pages with
+ * showPage(), or flips between them on its own with setPageTime(), without formatting anything. E.g.:
+ *
+ *   SevenSegPage volt(disp,4);
+ *   SevenSegPage amp(disp,4);
+ *
+ *   volt.write(124,1);		// 12.4
+ *   amp.write(35,2);		// 0.35
+ *   disp.showPage(0);
+ *   disp.setPageTime(2000);	// Flip every 2 seconds
+ *
+ * Pages must be kept as long as they're registered with the display, which is usually done by
+ * declaring them globally. A page may be written while it's shown.
+ */
+
+#ifndef SevenSegPage_h
+#define SevenSegPage_h
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegWindow.h"
+
+class SevenSegPage : public SevenSegWindow
+{
+
+  public:
+
+    // Constructor
+    SevenSegPage(SevenSeg &,int);
+
+    int page();
+
+  private:
+
+    signed char _page;	// Page number, -1 if it couldn't be registered
+    byte _masks[SEVENSEG_MAX_DIGITS+1];	// Segment masks followed by the symbol mask
+
+};
+
+#endif
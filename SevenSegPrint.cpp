@@ -0,0 +1,89 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegPrint.cpp - Print interface for SevenSeg displays
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Arduino.h"
+#include "SevenSegPrint.h"
+
+// Constructor
+SevenSegPrint::SevenSegPrint(SevenSeg &disp, int width){
+
+  if(width<0) width=0;
+  if(width>SEVENSEG_MAX_DIGITS) width=SEVENSEG_MAX_DIGITS;
+
+  _disp=&disp;
+  _width=width;
+  _back=0;
+
+  for(int i=0;i<=SEVENSEG_MAX_DIGITS;i++) _buf[1][i]=0;
+  begin();
+
+}
+
+// Starts writing at the first digit of an empty buffer
+void SevenSegPrint::begin(){
+
+  for(int i=0;i<=SEVENSEG_MAX_DIGITS;i++) _buf[_back][i]=0;
+  _cursor=0;
+
+}
+
+size_t SevenSegPrint::write(uint8_t c){
+
+  if(c=='\n'){
+    commit();
+    return 1;
+  }
+  if(c=='\r') return 1;
+
+  byte *buf = _buf[_back];
+
+  // Decimal point on the previous digit, unless it already has one
+  if(c=='.' && _cursor>0 && !(buf[_cursor-1] & SEVENSEG_DP)){
+    buf[_cursor-1] |= SEVENSEG_DP;
+    return 1;
+  }
+
+  if(_cursor>=_width) return 0;	// Full
+
+  buf[_cursor++] = _disp->charMask(c);
+  return 1;
+
+}
+
+void SevenSegPrint::commit(){
+
+  // Never more than the display's digits, such that no glyph is taken for the symbol mask
+  int count = (_width<_disp->_numOfDigits) ? _width : _disp->_numOfDigits;
+  _disp->writeSegmentsRef(_buf[_back], count);
+
+  // Write the other buffer from now on
+  _back ^= 1;
+  begin();
+
+}
+
+void SevenSegPrint::clear(){
+
+  begin();
+  commit();
+
+}
@@ -0,0 +1,72 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegPrint.h - Print interface for SevenSeg displays
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * SevenSegPrint lets a SevenSeg display of "width" digits be written with Arduino's print functions.
+ * Each character printed is looked up in the display's font and put in the next digit of a buffer,
+ * and a '.' following a character lights the decimal point of that digit, like write(char*). Nothing
+ * is shown until commit() (or printing '\n', e.g. with println()) publishes the buffer and starts a new
+ * one. Characters beyond the width are dropped. clear() blanks the display. E.g.:
+ *
+ *   SevenSegPrint out(disp,4);
+ *
+ *   out.print(value,HEX);
+ *   out.print(F("h"));
+ *   out.commit();
+ *
+ * There are two buffers. One is shown by the display's interruptAction() while the other one is
+ * written, so publishing is only a matter of swapping them, and neither the heap nor a string is used.
+ * Without a timer commit() multiplexes the buffer once, like the other write functions.
+ */
+
+#ifndef SevenSegPrint_h
+#define SevenSegPrint_h
+
+#include "Arduino.h"
+#include "Print.h"
+#include "SevenSeg.h"
+
+class SevenSegPrint : public Print
+{
+
+  public:
+
+    // Constructor
+    SevenSegPrint(SevenSeg &,int);
+
+    size_t write(uint8_t);
+    using Print::write;
+    void commit();
+    void clear();
+
+  private:
+
+    SevenSeg *_disp;
+    byte _width;	// Number of digits
+    byte _cursor;	// Next digit to write
+    byte _back;		// Buffer being written. The other one is shown.
+    byte _buf[2][SEVENSEG_MAX_DIGITS+1];	// Segment masks. The last byte is for symbols and always 0.
+
+    void begin();
+
+};
+
+#endif
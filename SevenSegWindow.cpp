@@ -0,0 +1,145 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegWindow.cpp - Independent fields on a SevenSeg display
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Arduino.h"
+#include "SevenSegWindow.h"
+
+// Constructor
+SevenSegWindow::SevenSegWindow(SevenSeg &disp, int first, int width){
+
+  // Limit to the display's digits, or to the most it can have if its digit pins aren't set yet
+  int numOfDigits = disp._numOfDigits ? disp._numOfDigits : SEVENSEG_MAX_DIGITS;
+  if(first<0) first=0;
+  if(first>numOfDigits) first=numOfDigits;
+  if(width<0) width=0;
+  if(width>numOfDigits-first) width=numOfDigits-first;
+
+  _disp=&disp;
+  _masks=0;
+  _first=first;
+  _width=width;
+
+}
+
+SevenSegWindow::SevenSegWindow(SevenSeg &disp, byte *masks, int width){
+
+  if(width<0) width=0;
+  if(width>SEVENSEG_MAX_DIGITS) width=SEVENSEG_MAX_DIGITS;
+
+  _disp=&disp;
+  _masks=masks;
+  _first=0;
+  _width=width;
+
+}
+
+// Returns where in the frame the window's digits are, or 0 if the display's frame couldn't be allocated.
+// "width" is set to how many of the window's digits the display has.
+byte *SevenSegWindow::digits(int &width){
+
+  int numOfDigits = _disp->_numOfDigits;
+  int first = (_first<numOfDigits) ? _first : numOfDigits;
+  width = (_width<numOfDigits-first) ? _width : numOfDigits-first;
+
+  byte *frame = _masks ? _masks : _disp->getFrame();
+  if(frame==0) return 0;
+  return frame+first;
+
+}
+
+// Shows the colon if "c" is ':'. A page has its own symbol mask after the display's last digit, which is
+// rewritten on each write, while a window on the display's frame only ever sets the shared colon.
+void SevenSegWindow::writeSymbols(char c){
+
+  if(_masks){
+    _masks[_disp->_numOfDigits] = (c==':') ? SEVENSEG_COLON : 0;
+  } else if(c==':'){
+    _disp->setColon();
+  }
+
+}
+
+void SevenSegWindow::clear(){
+
+  int width;
+  byte *dst = digits(width);
+  if(dst==0) return;
+
+  for(int i=0;i<width;i++) dst[i]=0;
+  writeSymbols(0);
+
+}
+
+void SevenSegWindow::write(int num){
+  write((long int)num, 0);
+}
+
+void SevenSegWindow::write(long int num){
+  write(num, 0);
+}
+
+void SevenSegWindow::write(int num, int point){
+  write((long int)num, point);
+}
+
+void SevenSegWindow::write(long int num, int point){
+
+  int width;
+  byte *dst = digits(width);
+  if(dst==0) return;
+
+  _disp->renderInt(dst, width, num, point);
+  writeSymbols(0);
+
+}
+
+void SevenSegWindow::write(double num, int point){
+
+  write(SevenSeg::roundFixed(num, point), point);
+
+}
+
+void SevenSegWindow::write(char *str){
+
+  int width;
+  byte *dst = digits(width);
+  if(dst==0) return;
+
+  _disp->renderStr(dst, width, str);
+  writeSymbols(0);
+
+}
+
+void SevenSegWindow::writeClock(int aa, int bb){
+  writeClock(aa, bb, _disp->clockSeparator());
+}
+
+void SevenSegWindow::writeClock(int aa, int bb, char c){
+
+  int width;
+  byte *dst = digits(width);
+  if(dst==0) return;
+
+  _disp->renderClock(dst, width, aa, bb, c);
+  writeSymbols(c);
+
+}
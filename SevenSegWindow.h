@@ -0,0 +1,83 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegWindow.h - Independent fields on a SevenSeg display
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * A window is a field of "width" digits starting at digit "first" of a SevenSeg display. Each window
+ * has its own write functions with the same formatting as SevenSeg's, including decimal point and
+ * leading zero suppression, but only renders into its own digits of the frame shown by the display.
+ * Updating one window hence doesn't format the others. Requires a timer. E.g.:
+ *
+ *   SevenSegWindow temp(disp,0,4);
+ *   SevenSegWindow setpoint(disp,4,4);
+ *
+ *   temp.write(215,1);		// 21.5
+ *   setpoint.write(230,1);	// 23.0
+ *
+ * writeClock(aa,bb) separates aa and bb like the display's writeClock(aa,bb). The colon is shared by
+ * the whole display, so it stays on until the display is written.
+ *
+ * A window only covers the digits the display has, which are counted on each write since windows are
+ * usually declared before setDigitPins() is called. Using the display's own write functions makes it
+ * stop showing the windows until the next time a window is written.
+ */
+
+#ifndef SevenSegWindow_h
+#define SevenSegWindow_h
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+
+class SevenSegWindow
+{
+
+  public:
+
+    // Constructor
+    SevenSegWindow(SevenSeg &,int,int);
+
+    void clear();
+    void write(long int);
+    void write(int);
+    void write(long int,int);
+    void write(int,int);
+    void write(double,int);
+    void write(char*);
+    void writeClock(int,int,char);
+    void writeClock(int,int);
+
+  protected:
+
+    // Renders into "masks" instead of the display's frame (see SevenSegPage.h)
+    SevenSegWindow(SevenSeg &,byte *,int);
+
+  private:
+
+    SevenSeg *_disp;
+    byte *_masks;	// Segment masks followed by the symbol mask, 0 to use the display's frame
+    byte _first;	// First digit of the window
+    byte _width;	// Number of digits in the window
+
+    byte *digits(int &);
+    void writeSymbols(char);
+
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegBench.cpp - Cycle counts of SevenSeg on an ATmega328P, run under simavr by "make bench"
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Built once per configuration by "make bench": BENCH_INT writes an integer, BENCH_FIXED a fixed point
+ * number, BENCH_DOUBLE a double, BENCH_STRING a string, BENCH_CLOCK a clock with a colon on the segment
+ * lines, and BENCH_SYMBOL the same clock with the colon on a symbol digit. The display has 4 digits
+ * refreshed at 100 Hz.
+ *
+ * The cycles are counted by timer1 running at the CPU clock. The timer of the display is assigned but
+ * never started. Instead interruptAction() is called here with interrupts disabled, as the interrupt
+ * routine would, such that each tick can be timed. The cycles of entering and leaving the interrupt
+ * routine are not included. Timer0 (millis()) is stopped so that no other interrupt is counted. A frame
+ * starts each time digit 0 is switched on, which is seen on its pin, so nothing is added to the
+ * interrupt for the bench.
+ *
+ * interruptAction() switches digits with interrupts enabled. The cycles with interrupts disabled are
+ * found in a second pass, where a pin change interrupt is kept pending on pin A5: its routine toggles
+ * the pin again each time it runs, so it runs as soon as interrupts are enabled, and again between
+ * every instruction until they're disabled. The first and last time it runs mark the sei() and cli() of
+ * the tick. They're compared with those of a function enabling interrupts for one instruction, which
+ * cancels the cycles of the bench itself, so the result is within a few cycles.
+ *
+ * The results are printed on the serial port as "@name value" lines:
+ *
+ *   write		Cycles of the write function of the configuration
+ *   isr_tick_max	Most cycles of interruptAction() in one tick
+ *   isr_tick_avg	Average cycles of interruptAction() per tick
+ *   isr_frame		Cycles of interruptAction() per display frame
+ *   isr_lock_max	Most cycles of interruptAction() with interrupts disabled in one tick
+ *   ticks_frame	Ticks per display frame
+ *
+ * The sketch then sleeps with interrupts disabled, which ends the simulation. It may also be uploaded
+ * to an Arduino Uno, which prints the same lines at 115200 baud.
+ */
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include <avr/sleep.h>
+
+#define BENCH_FRAMES 8	// Display frames to average over
+
+SevenSeg disp(2,3,4,5,6,7,8);
+int digitPins[4]={9,10,11,12};
+
+#if defined(BENCH_STRING)
+char text[]="HELP";	// Shown by the interrupt, so it must be kept
+#endif
+
+static unsigned int overhead;	// Cycles of starting and reading the count
+
+static inline void startCount(){
+  TCNT1=0;
+}
+
+static inline unsigned int readCount(){
+  return TCNT1-overhead;
+}
+
+// Times of the first and last pin change interrupt since clearMarks()
+static volatile unsigned int firstMark, lastMark;
+static volatile byte marks;
+
+ISR(PCINT1_vect){
+  unsigned int t=TCNT1;
+  if(marks==0) firstMark=t;
+  lastMark=t;
+  marks=1;
+  PINC=(1<<PINC5);	// Toggle A5, such that the interrupt is pending again
+}
+
+static inline void clearMarks(){
+  marks=0;
+  PCIFR=(1<<PCIF1);
+}
+
+// Enables interrupts for one instruction. The reference for the interrupt-disabled cycles.
+static void __attribute__((noinline)) lockReference(){
+  sei();
+  asm volatile("nop");
+  cli();
+}
+
+// Calls interruptAction() until the next frame starts, i.e. digit 0 is switched on
+static void toNextFrame(){
+
+  int on = digitalRead(digitPins[0]);
+  for(;;){
+    disp.interruptAction();
+    int was = on;
+    on = digitalRead(digitPins[0]);
+    if(on==HIGH && was==LOW) return;	// The digits are on when HIGH (common anode)
+  }
+
+}
+
+static void report(const char *name, unsigned long int value){
+  Serial.print('@');
+  Serial.print(name);
+  Serial.print(' ');
+  Serial.println(value);
+}
+
+static void writeConfig(){
+
+#if defined(BENCH_INT)
+  disp.write(1234);
+#elif defined(BENCH_FIXED)
+  disp.write(1234,2);
+#elif defined(BENCH_DOUBLE)
+  disp.write(12.34);
+#elif defined(BENCH_STRING)
+  disp.write(text);
+#elif defined(BENCH_CLOCK) || defined(BENCH_SYMBOL)
+  disp.writeClock(12,34);
+#else
+#error "Define one of BENCH_INT, BENCH_FIXED, BENCH_DOUBLE, BENCH_STRING, BENCH_CLOCK or BENCH_SYMBOL"
+#endif
+
+}
+
+void setup(){
+
+  Serial.begin(115200);
+
+  disp.setDigitPins(4,digitPins);
+  disp.setDPPin(13);
+#if defined(BENCH_CLOCK)
+  disp.setColonPin(A0);
+#endif
+#if defined(BENCH_SYMBOL)
+  disp.setSymbPins(A1,A0,A0,A2);
+#endif
+  disp.setTimer(2);
+  disp.setRefreshRate(100);	// Sets the phase lengths, which need the timer and all digits assigned
+
+  pinMode(A5,OUTPUT);
+
+  noInterrupts();
+  TIMSK0=0;		// Stop millis()
+  TCCR1A=0;
+  TCCR1B=(1<<CS10);	// Timer1 counts CPU cycles
+  TIMSK1=0;
+
+  overhead=0;
+  startCount();
+  overhead=readCount();
+
+  startCount();
+  writeConfig();
+  unsigned int writeCycles=readCount();
+
+  // Cycles per tick and frame
+  toNextFrame();
+  unsigned long int ticks=0;
+  unsigned long int total=0;
+  unsigned int tickMax=0;
+  int frames=0;
+  int on=HIGH;
+  while(frames<BENCH_FRAMES){
+    startCount();
+    disp.interruptAction();
+    unsigned int cycles=readCount();
+    total+=cycles;
+    ticks++;
+    if(cycles>tickMax) tickMax=cycles;
+    int was=on;
+    on=digitalRead(digitPins[0]);
+    if(on==HIGH && was==LOW) frames++;
+  }
+
+  // Interrupt-disabled cycles of the reference
+  PCMSK1=(1<<PCINT13);
+  PCICR=(1<<PCIE1);
+  clearMarks();
+  startCount();
+  lockReference();
+  unsigned int refEnd=TCNT1;
+  unsigned int refHead=firstMark;
+  unsigned int refTail=refEnd-lastMark;
+
+  // Interrupt-disabled cycles per tick
+  toNextFrame();
+  unsigned int lockMax=0;
+  frames=0;
+  on=HIGH;
+  while(frames<BENCH_FRAMES){
+    clearMarks();
+    startCount();
+    disp.interruptAction();
+    unsigned int end=TCNT1;
+    unsigned int lock;
+    if(marks) lock=(firstMark-refHead)+(end-lastMark-refTail);
+    else lock=end-overhead;	// Interrupts never enabled
+    if(lock>lockMax) lockMax=lock;
+    int was=on;
+    on=digitalRead(digitPins[0]);
+    if(on==HIGH && was==LOW) frames++;
+  }
+
+  PCICR=0;
+  PCMSK1=0;
+  clearMarks();
+  interrupts();
+
+  report("write",writeCycles);
+  report("isr_tick_max",tickMax);
+  report("isr_tick_avg",total/ticks);
+  report("isr_frame",total/BENCH_FRAMES);
+  report("isr_lock_max",lockMax);
+  report("ticks_frame",ticks/BENCH_FRAMES);
+  Serial.flush();
+
+  noInterrupts();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+
+}
+
+void loop(){
+}
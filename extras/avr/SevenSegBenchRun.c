@@ -0,0 +1,93 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegBenchRun.c - Runs a benchmark sketch under simavr and prints its serial output
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Usage: runbench <firmware.elf>
+ *
+ * Loads the firmware into a simulated ATmega328P at 16 MHz and copies everything it writes to serial
+ * port 0 to stdout. Stops when the firmware sleeps with interrupts disabled, which SevenSegBench.cpp
+ * does when it's done. Returns 1 if the firmware crashes or runs for more than 10 simulated seconds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/avr_uart.h>
+
+#define RUN_MCU "atmega328p"
+#define RUN_FREQUENCY 16000000
+#define RUN_SECONDS 10
+
+static void uartOutput(struct avr_irq_t *irq, uint32_t value, void *param){
+  putchar(value);
+}
+
+int main(int argc, char *argv[]){
+
+  if(argc!=2){
+    fprintf(stderr, "Usage: %s <firmware.elf>\n", argv[0]);
+    return 2;
+  }
+
+  elf_firmware_t firmware;
+  memset(&firmware, 0, sizeof(firmware));
+  if(elf_read_firmware(argv[1], &firmware)!=0){
+    fprintf(stderr, "%s: can't read %s\n", argv[0], argv[1]);
+    return 2;
+  }
+  strcpy(firmware.mmcu, RUN_MCU);
+  firmware.frequency = RUN_FREQUENCY;
+
+  avr_t *avr = avr_make_mcu_by_name(RUN_MCU);
+  if(avr==0){
+    fprintf(stderr, "%s: simavr doesn't support %s\n", argv[0], RUN_MCU);
+    return 2;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &firmware);
+
+  // Take the serial output here instead of simavr printing it
+  uint32_t flags = 0;
+  avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+  flags &= ~AVR_UART_FLAG_STDIO;
+  avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOutput, 0);
+
+  int state = cpu_Running;
+  while(state!=cpu_Done && state!=cpu_Crashed){
+    if(avr->cycle>(avr_cycle_count_t)RUN_SECONDS*RUN_FREQUENCY){
+      fprintf(stderr, "%s: %s still running after %d s\n", argv[0], argv[1], RUN_SECONDS);
+      return 1;
+    }
+    state = avr_run(avr);
+  }
+
+  fflush(stdout);
+
+  if(state==cpu_Crashed){
+    fprintf(stderr, "%s: %s crashed\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  return 0;
+
+}
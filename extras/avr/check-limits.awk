@@ -0,0 +1,27 @@
+# Checks bench-report.txt against bench-limits.txt. Usage: awk -f check-limits.awk <limits> <report>
+# Both files have lines of: configuration metric value. Exits with 1 if a value exceeds its limit.
+# Values without a limit are listed, but don't fail.
+
+FNR==NR {
+  if($0 !~ /^#/ && NF==3) limit[$1 " " $2]=$3
+  next
+}
+
+{
+  key=$1 " " $2
+  if(!(key in limit)) key="* " $2
+  if(!(key in limit)){
+    unchecked++
+    next
+  }
+  if($3+0 > limit[key]+0){
+    printf "FAIL: %s %s is %s, limit %s\n", $1, $2, $3, limit[key]
+    failed=1
+  }
+}
+
+END {
+  if(failed) exit 1
+  if(unchecked) printf "NOTE: %d values have no limit in bench-limits.txt (see make limits)\n", unchecked
+  print "PASS: all limited values within bench-limits.txt"
+}
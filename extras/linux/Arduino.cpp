@@ -0,0 +1,156 @@
+/*
+  SevenSeg 1.2.1
+  Arduino.cpp - Arduino API subset for building SevenSeg on a Linux host
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * PINS
+ */
+
+static volatile int pinValues[ARDUINO_HOST_PINS];
+
+void pinMode(int pin, int mode){
+  if(mode==INPUT_PULLUP && pin>=0 && pin<ARDUINO_HOST_PINS) pinValues[pin] = HIGH;
+}
+
+void digitalWrite(int pin, int value){
+  if(pin>=0 && pin<ARDUINO_HOST_PINS) pinValues[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(int pin){
+  if(pin<0 || pin>=ARDUINO_HOST_PINS) return LOW;
+  return pinValues[pin];
+}
+
+/*
+ * TIME
+ */
+
+static unsigned long long nowUs(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec*1000000ULL + ts.tv_nsec/1000;
+}
+
+static const unsigned long long startUs = nowUs();
+
+unsigned long millis(){
+  return (unsigned long)((nowUs()-startUs)/1000);
+}
+
+unsigned long micros(){
+  return (unsigned long)(nowUs()-startUs);
+}
+
+void delay(unsigned long ms){
+  struct timespec ts;
+  ts.tv_sec = ms/1000;
+  ts.tv_nsec = (ms%1000)*1000000L;
+  while(nanosleep(&ts, &ts)!=0);
+}
+
+void delayMicroseconds(unsigned int us){
+  struct timespec ts;
+  ts.tv_sec = us/1000000;
+  ts.tv_nsec = (us%1000000)*1000L;
+  while(nanosleep(&ts, &ts)!=0);
+}
+
+/*
+ * STRING
+ */
+
+String::String(const char *str){
+  _len = strlen(str);
+  _buf = (char *)malloc(_len+1);
+  memcpy(_buf, str, _len+1);
+}
+
+String::String(const String &other){
+  _len = other._len;
+  _buf = (char *)malloc(_len+1);
+  memcpy(_buf, other._buf, _len+1);
+}
+
+String::~String(){
+  free(_buf);
+}
+
+String &String::operator=(const String &other){
+  if(this==&other) return *this;
+  char *buf = (char *)malloc(other._len+1);
+  memcpy(buf, other._buf, other._len+1);
+  free(_buf);
+  _buf = buf;
+  _len = other._len;
+  return *this;
+}
+
+char String::operator[](unsigned int index) const {
+  if(index>=_len) return 0;
+  return _buf[index];
+}
+
+unsigned int String::length() const {
+  return _len;
+}
+
+const char *String::c_str() const {
+  return _buf;
+}
+
+/*
+ * PRINT
+ */
+
+size_t Print::write(const uint8_t *buffer, size_t size){
+  size_t n = 0;
+  while(size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::write(const char *str){
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const char *str){
+  return write(str);
+}
+
+size_t Print::print(char c){
+  return write((uint8_t)c);
+}
+
+size_t Print::print(long n, int base){
+  char buf[8*sizeof(long)+2];
+  if(base==16) snprintf(buf, sizeof(buf), "%lX", n);
+  else snprintf(buf, sizeof(buf), "%ld", n);
+  return write(buf);
+}
+
+size_t Print::print(double num, int digits){
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, num);
+  return write(buf);
+}
@@ -0,0 +1,105 @@
+/*
+  SevenSeg 1.2.1
+  Arduino.h - Arduino API subset for building SevenSeg on a Linux host
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Provides what SevenSeg uses from the Arduino core, for building the library and sketches with g++
+ * on a Linux machine without an Arduino environment. Put this directory first on the include path.
+ *
+ * The pins written with digitalWrite() are kept in memory and can be read back with digitalRead().
+ * millis() and micros() count from the start of the program. cli() and sei() are the critical
+ * section shared with the timer thread (see SevenSegLinux.h).
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Pins
+#define ARDUINO_HOST_PINS 64
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+// Time
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Interrupts
+void sevenSegLock();
+void sevenSegUnlock();
+#define cli() sevenSegLock()
+#define sei() sevenSegUnlock()
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// Dynamically allocated string. Indexing past the end gives 0 like on the Arduino.
+class String
+{
+
+  public:
+
+    String(const char *str = "");
+    String(const String &);
+    ~String();
+
+    String &operator=(const String &);
+    char operator[](unsigned int index) const;
+    unsigned int length() const;
+    const char *c_str() const;
+
+  private:
+
+    char *_buf;
+    unsigned int _len;
+
+};
+
+#include "Print.h"
+
+#endif
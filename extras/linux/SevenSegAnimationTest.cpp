@@ -0,0 +1,106 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegAnimationTest.cpp - Checks the timing of playAnimation() on the Linux host
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Plays one-shot animations at different rates and checks that they finish after count/rate seconds
+ * (within one display frame plus scheduling slack), that rates above the refresh rate show one
+ * animation frame per display frame, and that a zero rate or frame count is ignored.
+ */
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegLinux.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)){ printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+static const byte frames[] PROGMEM = {
+  SEVENSEG_A, 0, 0, 0,
+  0, SEVENSEG_A, 0, 0,
+  0, 0, SEVENSEG_A, 0,
+  0, 0, 0, SEVENSEG_A,
+  0, 0, 0, SEVENSEG_D,
+  0, 0, SEVENSEG_D, 0,
+  0, SEVENSEG_D, 0, 0,
+  SEVENSEG_D, 0, 0, 0,
+};
+
+// Plays the animation once and returns how many milliseconds it took, or -1 on timeout
+static long int play(SevenSeg &disp, int count, int rate){
+
+  disp.playAnimation(frames, count, rate, 0);
+  unsigned long int start = millis();
+  while(!disp.animationDone()){
+    if(millis()-start>5000) return -1;
+    delay(1);
+  }
+  return millis()-start;
+
+}
+
+int main(){
+
+  SevenSeg disp(0,1,2,3,4,5,6);
+  SevenSegGpioMem gpio;
+  int digitPins[4]={7,8,9,10};
+
+  disp.setGpio(&gpio);
+  disp.setDigitPins(4,digitPins);
+  disp.setRefreshRate(100);	// 10ms per display frame
+  disp.setTimer(0);
+  disp.startTimer();
+
+  // 8 frames at 20 and 50 frames per second
+  long int t20 = play(disp, 8, 20);
+  long int t50 = play(disp, 8, 50);
+  CHECK(t20>=400-10 && t20<=400+10+50);
+  CHECK(t50>=160-10 && t50<=160+10+50);
+
+  // 1000 frames per second is limited to the refresh rate, but must still finish
+  long int tFast = play(disp, 8, 1000);
+  CHECK(tFast>=80-10 && tFast<=80+10+50);
+
+  // Invalid arguments leave the display as it was
+  disp.write(1234);
+  disp.playAnimation(frames, 8, 0, 0);
+  disp.playAnimation(frames, 0, 10, 0);
+  delay(50);
+  CHECK(disp.animationDone()==1);	// Still the state of the last animation
+  int mask = 0;
+  cli();
+  if(gpio.read(digitPins[0])==HIGH || gpio.read(digitPins[1])==HIGH ||
+     gpio.read(digitPins[2])==HIGH || gpio.read(digitPins[3])==HIGH){
+    for(int i=0;i<7;i++) if(gpio.read(i)==LOW) mask |= 1<<i;
+  }
+  sei();
+  CHECK(mask!=0 && mask!=SEVENSEG_A && mask!=SEVENSEG_D);	// A digit of 1234, not an animation frame
+
+  disp.stopTimer();
+
+  printf("%s: 8 frames took %ld ms at 20 fps, %ld ms at 50 fps and %ld ms at 1000 fps\n",
+    failures ? "FAIL" : "PASS", t20, t50, tFast);
+
+  return failures ? 1 : 0;
+
+}
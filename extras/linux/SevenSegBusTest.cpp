@@ -0,0 +1,96 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegBusTest.cpp - Runs two displays on a SevenSegBus on the Linux host
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Counts a self-running clock down from 00:02 on both displays of a bus, and checks that both reach
+ * 00:00 after two seconds although each display is only multiplexed half of the time. Also checks
+ * that no two digits are ever on at the same time.
+ */
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegBus.h"
+#include "SevenSegLinux.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)){ printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+int main(){
+
+  SevenSeg left(0,1,2,3,4,5,6);
+  SevenSeg right(0,1,2,3,4,5,6);
+  SevenSegBus bus;
+  SevenSegGpioMem gpio;
+  int leftPins[4]={7,8,9,10};
+  int rightPins[4]={11,12,13,14};
+
+  left.setGpio(&gpio);
+  right.setGpio(&gpio);
+  left.setDigitPins(4,leftPins);
+  right.setDigitPins(4,rightPins);
+  bus.add(left);
+  bus.add(right);
+  bus.setRefreshRate(100);
+  bus.setTimer(0);
+
+  left.setClock(0,2);
+  right.setClock(0,2);
+  left.setClockDir(-1);
+  right.setClockDir(-1);
+  left.startClock();
+  right.startClock();
+  bus.startTimer();
+
+  unsigned long int start = millis();
+  long int leftZero = -1;
+  long int rightZero = -1;
+  int overlaps = 0;
+
+  while(millis()-start<3000 && (leftZero<0 || rightZero<0)){
+
+    cli();
+    int on = 0;
+    for(int i=7;i<=14;i++) if(gpio.read(i)==HIGH) on++;
+    sei();
+    if(on>1) overlaps++;
+
+    if(leftZero<0 && left.clockZero()) leftZero = millis()-start;
+    if(rightZero<0 && right.clockZero()) rightZero = millis()-start;
+
+    delay(1);
+
+  }
+
+  bus.stopTimer();
+
+  CHECK(leftZero>=2000-20 && leftZero<=2000+50);
+  CHECK(rightZero>=2000-20 && rightZero<=2000+50);
+  CHECK(overlaps==0);
+
+  printf("%s: the clocks reached zero after %ld ms (left) and %ld ms (right)\n",
+    failures ? "FAIL" : "PASS", leftZero, rightZero);
+
+  return failures ? 1 : 0;
+
+}
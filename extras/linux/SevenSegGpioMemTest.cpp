@@ -0,0 +1,108 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegGpioMemTest.cpp - Runs SevenSeg on the Linux host against SevenSegGpioMem
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Multiplexes "1234" on four digits from the timer thread and samples the in-memory pins from the
+ * main thread inside cli()/sei(). Checks that the timer thread is kept out while the section is
+ * held, that at most one digit is on at a time, that it shows the right segments, and that every
+ * digit is refreshed.
+ */
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegLinux.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if(!(cond)){ printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+int main(){
+
+  SevenSeg disp(0,1,2,3,4,5,6);
+  SevenSegGpioMem gpio;
+  int digitPins[4]={7,8,9,10};
+  int segPins[7]={0,1,2,3,4,5,6};
+  const char *text = "1234";
+
+  disp.setGpio(&gpio);
+  disp.setDigitPins(4,digitPins);
+  disp.setRefreshRate(100);
+  disp.setTimer(0);
+  disp.startTimer();
+  disp.write(1234);
+
+  // The timer thread must not write any pin while the main thread is in a critical section
+  delay(20);
+  cli();
+  long int before = gpio.requests();
+  delay(5);
+  long int after = gpio.requests();
+  sei();
+  CHECK(before>0);
+  CHECK(after==before);
+
+  int seen[4]={0,0,0,0};
+  int overlaps = 0;
+  int wrong = 0;
+
+  unsigned long int start = millis();
+  while(millis()-start<200){
+
+    cli();
+
+    int on = -1;
+    int count = 0;
+    for(int i=0;i<4;i++){
+      if(gpio.read(digitPins[i])==HIGH){	// Common anode is the default
+        on = i;
+        count++;
+      }
+    }
+
+    int mask = 0;
+    for(int i=0;i<7;i++) if(gpio.read(segPins[i])==LOW) mask |= 1<<i;
+
+    sei();
+
+    if(count>1) overlaps++;
+    if(count==1){
+      seen[on]++;
+      if(mask!=disp.charMask(text[on])) wrong++;
+    }
+
+    delayMicroseconds(100);
+
+  }
+
+  disp.stopTimer();
+
+  CHECK(overlaps==0);
+  CHECK(wrong==0);
+  for(int i=0;i<4;i++) CHECK(seen[i]>0);
+
+  printf("%s: %ld pin writes in %ld requests, digits seen %d %d %d %d\n",
+    failures ? "FAIL" : "PASS", gpio.writes(), gpio.requests(), seen[0], seen[1], seen[2], seen[3]);
+
+  return failures ? 1 : 0;
+
+}
@@ -0,0 +1,89 @@
+/*
+  SevenSeg 1.2.1
+  SevenSegSize.cpp - Sketches for comparing the code size of feature sets on the Linux host
+  Copyright 2013, 2015, 2017 Sigvald Marholm <marholm@marebakken.com>
+
+  This file is part of SevenSeg.
+
+  SevenSeg is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  SevenSeg is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with SevenSeg.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Built once per feature set by "make size" with unused sections removed by the linker, such that
+ * the text size shows what each feature set pulls in. SIZE_INT only writes integers, SIZE_CLOCK runs
+ * the self-running clock, and SIZE_ALL uses every feature. "make size" writes the results to
+ * build/size-report.txt.
+ */
+
+#include "Arduino.h"
+#include "SevenSeg.h"
+#include "SevenSegLinux.h"
+
+static const byte frames[] PROGMEM = {SEVENSEG_A, 0, 0, 0,   0, SEVENSEG_A, 0, 0};
+
+#if defined(SIZE_ALL)
+static void frameDone(){}
+#endif
+
+int main(){
+
+  SevenSeg disp(0,1,2,3,4,5,6);
+  SevenSegGpioMem gpio;
+  int digitPins[4]={7,8,9,10};
+
+  disp.setGpio(&gpio);
+  disp.setDigitPins(4,digitPins);
+  disp.setTimer(0);
+  disp.startTimer();
+
+#if defined(SIZE_INT)
+  disp.write(1234);
+#endif
+
+#if defined(SIZE_CLOCK)
+  disp.setClock(12,0);
+  disp.startClock();
+#endif
+
+#if defined(SIZE_ALL)
+  static byte page[5];
+  static SevenSegQueue queue;
+  int keyPins[1]={11};
+  disp.write(1234);
+  disp.write(12.5,1);
+  char text[]="ABCD";
+  disp.write(text);
+  disp.write(String("ABCD"));
+  disp.writeHex(0xBEEF);
+  disp.setClock(12,0);
+  disp.startClock();
+  disp.setAutoStop(1);
+  disp.setIdle(1000,4);
+  disp.setScanOrder(SEVENSEG_SCAN_INTERLEAVED);
+  disp.setFrameCallback(frameDone);
+  disp.fadeTo(50,500);
+  disp.showPage(disp.addPage(page));
+  disp.setPageTime(1000);
+  disp.playAnimation(frames,2,10,1);
+  disp.setQueue(&queue);
+  disp.setKeyPins(1,keyPins);
+  disp.getKeyEvent();
+#endif
+
+  delay(10);
+  disp.stopTimer();
+
+  return 0;
+
+}